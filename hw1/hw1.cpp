@@ -11,162 +11,755 @@
  * @date 1/27/2018
  */
 #include <iostream>
-#include <list>    // For list object
-#include <queue>   // For queue object
 #include <string>
 #include <utility> // For pair object
-#include <algorithm> // For sort()
-#include <functional> // for less
-#include <stack>  // For statck
+#include <cstring> // For memcpy()
+#include <chrono> // For timing the benchmark
+#include <cstdlib> // For atoi()
+#include <vector>
+#include <thread> // For the parallel BFS levels
+#include <functional>
+#include <mutex>  // For the ordered batch output
+#include <atomic>
 #define DEBUG 0 // Change this number to 1 for debugging outputs
+// Levels whose frontier has fewer edges than this run on one thread
+#define BFS_PARALLEL_EDGES 65536
+// Direction switches: go bottom-up when the frontier has more than
+// 1/BFS_ALPHA of the unexplored edges, back when it has fewer than
+// 1/BFS_BETA of the vertices
+#define BFS_ALPHA 14
+#define BFS_BETA 24
+// print makes its output in windows of at least PRINT_BUFFER_MIN bytes,
+// or PRINT_BYTES_PER_VERTEX bytes per vertex, so the DFS of each window
+// costs less than the bytes it makes
+#define PRINT_BUFFER_MIN (1LL << 26)
+#define PRINT_BYTES_PER_VERTEX 16
+// Trees with at least this many vertices are renumbered in BFS order
+// from the core before the last BFS and print
+#define RELABEL_MIN_VERTICES 65536
+// ID_map sorts the IDs this many bits a pass
+#define ID_RADIX_BITS 11
 using namespace std;
 
+class Tree;
+void run_threads(int count, function<void(int)> job);
+int format_vertex(int v, char* out);
+int format_id(unsigned long long id, char* out);
+void read_all_text(istream &in, string &text);
+bool next_int(const string &text, size_t &i, int &value);
+bool parse_id(const string &word, unsigned long long &id);
+int read_all_ints(istream &in, vector<int> &values);
+int run_batch(bool benchmark, int num_threads);
+int run_queries(Tree &tree, int num_vertices, int num_threads);
+int benchmark_queries(Tree &tree, int num_vertices, int count, int num_threads);
+int run_ids(int num_threads);
+int benchmark_ids(long long num_edges);
+
+/**
+ * A BFS that is run many times over the same tree. The buffers are
+ * allocated once. Instead of resetting distance and parents before
+ * every run, each run gets a new epoch, and a vertex counts as visited
+ * only if its stamp is the current epoch. The queue is a flat array
+ * that also keeps the vertices in the order BFS reached them.
+ *
+ * With more than one thread, wide levels are expanded in parallel.
+ */
+class BFS_engine{
+  public:
+    BFS_engine(int num_vertices, int num_threads);
+    ~BFS_engine();
+    void resize(int num_vertices);
+    void run(int* offsets, int* targets, int source);
+    void expand_parallel(int* offsets, int* targets, int level_start,
+      int level_end, bool bottom_up, int &tail, long long &next_edges);
+    int get_distance(int v);
+    int get_parent(int v);
+    int get_visited_count();
+    int get_visited(int i);
+
+  private:
+    int num_vertices;
+    int capacity; // The buffers have room for this many vertices
+    int* frontier; // The queue; frontier[0..visited_count) in BFS order
+    int* distance;
+    int* parents;
+    unsigned int* stamp;
+    unsigned int epoch;
+    int visited_count;
+    int num_threads;
+    // Vertices each thread found for the next level, and their parents
+    vector<vector<int> > found;
+    vector<vector<int> > found_parent;
+};
+
 class Tree{
   public:
-    Tree(int num_vertices);
+    Tree(int num_vertices, int num_threads);
     ~Tree();
+    void reset(int num_vertices);
     void add_edge(int u, int v);
+    bool build_adjacency();
     void BFS(int source);
     pair<int,int> find_longest_path();
     int get_parent(int v);
-    void reset_arrays();
+    int get_distance(int v);
+    int get_visited(int i);
+    int find_core(int &diameter, int* distance_a);
+    int find_core_single_pass(int &diameter, int* endpoints, int* centers);
     void set_flag();
-    void print(int core);    
+    void relabel();
+    void set_labels(const unsigned long long* labels);
+    void print(int core, ostream &out);    
+    void print(int core, string &text);
+    void benchmark_BFS(int runs, int num_threads);
+    void copy_distances(int* out);
+    void eccentricities(int* distance_a, int diameter, int* ecc);
+    void print_eccentricities(int* ecc);
+    int check_eccentricities(int* ecc, int samples);
 
   private:
     int num_vertices;
-    int* distance;
-    int* parents;
-    list<int> *neighbors; // Adjacency list    
+    int capacity; // offsets and targets have room for this many vertices
+    BFS_engine engine; // Distance and parents of the last BFS
+    // Adjacency in compressed sparse row form: the neighbors of u are
+    // targets[offsets[u]] to targets[offsets[u+1]-1], smallest first.
+    int* offsets;
+    int* targets;
+    // Edges as they are read, until build_adjacency turns them into CSR
+    int* edge_u;
+    int* edge_v;
+    int num_edges;
     bool print_out; // Flag to check if we need to print
+    const unsigned long long* labels; // What print shows for each vertex
+    // After relabel, the number each vertex had in the input (print puts
+    // the lines in that order and shows that number, or its label)
+    vector<int> original;
+    int format_label(int v, char* out);
+    // find_core_single_pass: the deepest vertex (the smallest, if more
+    // than one) of the subtree of every vertex, with the tree rooted at 0
+    vector<int> deepest;
+    // A tree that is reset is a workspace for many trees: it keeps the
+    // edge arrays and every buffer below, which only grow. Otherwise
+    // build_adjacency frees what the BFS and print no longer need.
+    bool workspace;
+    vector<int> build_next; // build_adjacency: union-find, then list ends
+    vector<int> build_unsorted; // build_adjacency: lists in input order
+    // print: line starts and the DFS stack, for print_capacity vertices
+    // (new[], so the deep end of the stack is never touched in a shallow
+    // tree), the current path and the output window
+    int print_capacity;
+    long long* print_line_start;
+    int* print_stack_vertex;
+    int* print_stack_edge;
+    long long* print_stack_length;
+    vector<char> print_path;
+    vector<char> print_buffer;
+    void print_windows(int core, ostream* out, string* text);
+};
+
+/**
+ * Distance, ancestor and path queries on a tree, rooted where its last
+ * BFS started (the core), built from that BFS's parents and distances.
+ *
+ * The vertices are numbered in DFS preorder, which is the Euler tour of
+ * the tree with only the first visit of each vertex kept: the subtree
+ * of v is the range [pre[v], pre[v] + size[v]), and for pre[u] < pre[v]
+ * the LCA of u and v is the parent of the shallowest vertex in
+ * (pre[u], pre[v]]. A sparse table over that order answers it in O(1).
+ * The ancestor of v at depth d is the last vertex at depth d that comes
+ * before v in preorder, a binary search in the list of depth d.
+ */
+class Path_index{
+  public:
+    Path_index(Tree &tree, int num_vertices);
+    int lca(int u, int v);
+    int distance(int u, int v);
+    bool is_ancestor(int u, int v);
+    int ancestor_at_depth(int v, int d);
+    int kth_on_path(int u, int v, int k);
+    long long get_bytes();
+
+  private:
+    int shallower(int a, int b);
+    int num_vertices;
+    vector<int> depth;
+    vector<int> parent;
+    vector<int> pre; // Position of each vertex in preorder
+    vector<int> size; // Vertices in the subtree of each vertex
+    // table[j][i] is the shallowest vertex of order[i .. i + 2^j)
+    vector<vector<int> > table;
+    vector<int> log2; // floor(log2(i))
+    // Positions in preorder of the vertices at depth d are
+    // depth_pre[depth_start[d] .. depth_start[d + 1]), in order
+    vector<int> depth_start;
+    vector<int> depth_pre;
+    vector<int> order; // order[pre[v]] = v
+};
+
+/**
+ * Maps sparse 64-bit vertex IDs to 0..n-1. While the edges are read,
+ * an open-addressing hash table (linear probing, at most 3/4 full)
+ * numbers the IDs in the order they are first seen. sort_ids then
+ * radix sorts the distinct IDs and renumbers them in ID order, so the
+ * smallest ID is vertex 0 and the ties of the BFS go to the smaller ID,
+ * as with dense input.
+ */
+class ID_map{
+  public:
+    ID_map(int num_vertices);
+    int insert(unsigned long long id);
+    void sort_ids();
+    int get_rank(int first_seen);
+    int get_count();
+    unsigned long long* get_ids();
+
+  private:
+    int num_vertices;
+    int count; // Distinct IDs so far
+    unsigned long long mask; // Table size - 1 (a power of two)
+    vector<unsigned long long> table_id;
+    vector<int> table_first; // -1 for an empty slot
+    vector<unsigned long long> ids; // After sort_ids, the ID of each vertex
+    vector<int> rank; // After sort_ids, the vertex of each first-seen number
 };
 
+/* Constructor: the buffers are sized once for the tree */
+BFS_engine::BFS_engine(int num_vertices, int num_threads){
+  this->num_vertices = num_vertices;
+  this->num_threads = (num_threads < 1) ? 1 : num_threads;
+  found.resize(this->num_threads);
+  found_parent.resize(this->num_threads);
+  capacity = num_vertices;
+  frontier = new int[num_vertices];
+  distance = new int[num_vertices];
+  parents = new int[num_vertices];
+  stamp = new unsigned int[num_vertices];
+  for (int i = 0; i < num_vertices; i++){
+    stamp[i] = 0;
+  }
+  epoch = 0;
+  visited_count = 0;
+}
+
+/* Destructor */
+BFS_engine::~BFS_engine(){
+  delete[] frontier;
+  delete[] distance;
+  delete[] parents;
+  delete[] stamp;
+}
+
+/**
+ * void resize
+ *
+ * Makes the engine ready for a tree of num_vertices vertices. The
+ * buffers are only reallocated if they are too small.
+ *
+ * @param num_vertices The number of vertices of the next tree.
+ */
+void BFS_engine::resize(int num_vertices){
+  this->num_vertices = num_vertices;
+  visited_count = 0;
+  if (num_vertices <= capacity){
+    return;
+  }
+  delete[] frontier;
+  delete[] distance;
+  delete[] parents;
+  delete[] stamp;
+  capacity = num_vertices;
+  frontier = new int[capacity];
+  distance = new int[capacity];
+  parents = new int[capacity];
+  stamp = new unsigned int[capacity];
+  for (int i = 0; i < capacity; i++){
+    stamp[i] = 0;
+  }
+}
+
+/**
+ * void run
+ *
+ * BFS from source over a CSR adjacency, level by level. The frontier
+ * array is the queue: each level is appended at the tail, and nothing
+ * is ever removed, so afterwards it holds every visited vertex in BFS
+ * order. Neighbors are scanned smallest first, so each vertex gets the
+ * smallest of its parents in the previous level.
+ *
+ * Levels with few frontier edges are expanded on this thread. With more
+ * threads, wide levels go to expand_parallel, top-down or (when the
+ * frontier holds a large part of the edges left) bottom-up.
+ *
+ * @param offsets The CSR offsets of the tree.
+ * @param targets The CSR targets of the tree.
+ * @param source The source or vertex to run BFS on.
+ */
+void BFS_engine::run(int* offsets, int* targets, int source){
+  // A new epoch marks every vertex unvisited. Only when the counter
+  // wraps around do the stamps have to be cleared.
+  epoch++;
+  if (epoch == 0){
+    for (int i = 0; i < num_vertices; i++){
+      stamp[i] = 0;
+    }
+    epoch = 1;
+  }
+
+  frontier[0] = source;
+  stamp[source] = epoch;
+  distance[source] = 0;
+  parents[source] = source;
+
+  int level_start = 0;
+  int level_end = 1;
+  long long frontier_edges = offsets[source + 1] - offsets[source];
+  long long unexplored = offsets[num_vertices] - frontier_edges;
+  bool bottom_up = false;
+
+  while (level_start < level_end){
+    int tail = level_end;
+    long long next_edges = 0;
+
+    if (num_threads > 1){
+      if (!bottom_up && frontier_edges > unexplored / BFS_ALPHA){
+        bottom_up = true;
+      }
+      else if (bottom_up && level_end - level_start < num_vertices / BFS_BETA){
+        bottom_up = false;
+      }
+    }
+
+    if (num_threads > 1 && (bottom_up || frontier_edges >= BFS_PARALLEL_EDGES)){
+      expand_parallel(offsets, targets, level_start, level_end, bottom_up, tail,
+        next_edges);
+    }
+    else{
+      for (int i = level_start; i < level_end; i++){
+        int u = frontier[i];
+        int next_distance = distance[u] + 1;
+        for (int k = offsets[u]; k < offsets[u + 1]; k++){
+          int v = targets[k];
+          if (stamp[v] != epoch){
+            stamp[v] = epoch;
+            distance[v] = next_distance;
+            parents[v] = u;
+            frontier[tail++] = v;
+            next_edges = next_edges + offsets[v + 1] - offsets[v];
+          }
+        }
+      }
+    }
+
+    unexplored = unexplored - next_edges;
+    frontier_edges = next_edges;
+    level_start = level_end;
+    level_end = tail;
+  }
+  visited_count = level_end;
+}
+
+/**
+ * void expand_parallel
+ *
+ * Expands one level on num_threads threads. Each thread first collects
+ * the vertices of the next level it finds, with their parents, in its
+ * own lists; then every thread writes its own lists into the arrays at
+ * its place after the level. Nothing is written while the threads read
+ * the stamps, and in a tree a vertex is found by exactly one thread (it
+ * has one parent), so no vertex is claimed twice and no atomics are
+ * needed.
+ *
+ * Top-down splits the frontier between the threads. Bottom-up splits
+ * all vertices; each unvisited one looks for a neighbor in the level
+ * (the first it finds is its smallest, and in a tree its only, parent).
+ *
+ * @param offsets The CSR offsets of the tree.
+ * @param targets The CSR targets of the tree.
+ * @param level_start The first frontier position of the level.
+ * @param level_end One past the last frontier position of the level.
+ * @param bottom_up Whether to search bottom-up.
+ * @param tail The address to the end of the frontier, moved past the
+ *             next level.
+ * @param next_edges The address to the number of edges of the next level.
+ */
+void BFS_engine::expand_parallel(int* offsets, int* targets, int level_start,
+  int level_end, bool bottom_up, int &tail, long long &next_edges){
+  int level_distance = distance[frontier[level_start]];
+  int level_size = level_end - level_start;
+
+  run_threads(num_threads, [&](int t){
+    found[t].clear();
+    found_parent[t].clear();
+    if (bottom_up){
+      int first = (int) ((long long) num_vertices * t / num_threads);
+      int last = (int) ((long long) num_vertices * (t + 1) / num_threads);
+      for (int v = first; v < last; v++){
+        if (stamp[v] == epoch){
+          continue;
+        }
+        for (int k = offsets[v]; k < offsets[v + 1]; k++){
+          int w = targets[k];
+          if (stamp[w] == epoch && distance[w] == level_distance){
+            found[t].push_back(v);
+            found_parent[t].push_back(w);
+            break;
+          }
+        }
+      }
+    }
+    else{
+      int first = level_start + (int) ((long long) level_size * t / num_threads);
+      int last = level_start + (int) ((long long) level_size * (t + 1) / num_threads);
+      for (int i = first; i < last; i++){
+        int u = frontier[i];
+        for (int k = offsets[u]; k < offsets[u + 1]; k++){
+          int v = targets[k];
+          if (stamp[v] != epoch){
+            found[t].push_back(v);
+            found_parent[t].push_back(u);
+          }
+        }
+      }
+    }
+  });
+
+  vector<int> position(num_threads);
+  vector<long long> edges(num_threads, 0);
+  for (int t = 0; t < num_threads; t++){
+    position[t] = tail;
+    tail = tail + (int) found[t].size();
+  }
+
+  run_threads(num_threads, [&](int t){
+    for (int j = 0; j < (int) found[t].size(); j++){
+      int v = found[t][j];
+      stamp[v] = epoch;
+      distance[v] = level_distance + 1;
+      parents[v] = found_parent[t][j];
+      frontier[position[t] + j] = v;
+      edges[t] = edges[t] + offsets[v + 1] - offsets[v];
+    }
+  });
+  for (int t = 0; t < num_threads; t++){
+    next_edges = next_edges + edges[t];
+  }
+}
+
+/**
+ * int get_distance
+ *
+ * @param v The vertex.
+ * @return The distance of v from the source of the last run, or -1 if
+ *         the last run did not reach v.
+ */
+int BFS_engine::get_distance(int v){
+  return (stamp[v] == epoch) ? distance[v] : -1;
+}
+
+/**
+ * int get_parent
+ *
+ * @param v The vertex.
+ * @return The parent of v in the last run, or -1 if it did not reach v.
+ */
+int BFS_engine::get_parent(int v){
+  return (stamp[v] == epoch) ? parents[v] : -1;
+}
+
+/**
+ * int get_visited_count
+ *
+ * @return The number of vertices the last run reached.
+ */
+int BFS_engine::get_visited_count(){
+  return visited_count;
+}
+
+/**
+ * int get_visited
+ *
+ * @param i The position in BFS order, 0 <= i < get_visited_count().
+ * @return The i-th vertex the last run reached.
+ */
+int BFS_engine::get_visited(int i){
+  return frontier[i];
+}
+
+/**
+ * void run_threads
+ *
+ * Runs job(t) for t = 0 .. count-1, each on its own thread (job(0) on
+ * the calling one), and waits for all of them.
+ *
+ * @param count The number of threads.
+ * @param job The work of one thread.
+ */
+void run_threads(int count, function<void(int)> job){
+  vector<thread> threads;
+  for (int t = 1; t < count; t++){
+    threads.push_back(thread(job, t));
+  }
+  job(0);
+  for (int t = 0; t < (int) threads.size(); t++){
+    threads[t].join();
+  }
+}
+
 /* Constructor */
-Tree::Tree(int num_vertices){
+Tree::Tree(int num_vertices, int num_threads) : engine(num_vertices, num_threads){
   this->num_vertices = num_vertices;  
-  /* Dynamically allocate memory for adjacency list */
-  neighbors = new list<int>[num_vertices];
+  capacity = num_vertices;
+  /* A tree has num_vertices - 1 edges, read them into flat arrays */
+  edge_u = new int[num_vertices];
+  edge_v = new int[num_vertices];
+  num_edges = 0;
+  offsets = NULL;
+  targets = NULL;
   print_out = false;
+  labels = NULL;
+  workspace = false;
+  print_capacity = 0;
+  print_line_start = NULL;
+  print_stack_vertex = NULL;
+  print_stack_edge = NULL;
+  print_stack_length = NULL;
 }
 
 /* Destructor */
 Tree::~Tree(){
-  delete[] neighbors;
-  delete[] parents;
-  delete[] distance;
+  delete[] edge_u;
+  delete[] edge_v;
+  delete[] offsets;
+  delete[] targets;
+  delete[] print_line_start;
+  delete[] print_stack_vertex;
+  delete[] print_stack_edge;
+  delete[] print_stack_length;
+}
+
+/**
+ * void reset
+ *
+ * Empties the tree so it can be used for another one with num_vertices
+ * vertices. From now on the tree is a workspace: arrays are only
+ * reallocated when a tree needs more room than they have.
+ *
+ * @param num_vertices The number of vertices of the next tree.
+ */
+void Tree::reset(int num_vertices){
+  workspace = true;
+  if (num_vertices > capacity){
+    delete[] offsets;
+    delete[] targets;
+    delete[] edge_u;
+    delete[] edge_v;
+    offsets = NULL;
+    targets = NULL;
+    edge_u = NULL;
+    edge_v = NULL;
+    capacity = num_vertices;
+  }
+  if (edge_u == NULL){
+    edge_u = new int[capacity];
+    edge_v = new int[capacity];
+  }
+  this->num_vertices = num_vertices;
+  num_edges = 0;
+  original.clear();
+  engine.resize(num_vertices);
 }
 
 /**
  * void add_edge
  * 
  * This member function is used to add the edge of vertex u
- * and vertex v. The neighbors of vertex u will be stored in 
- * a list container that variable neighbor points to. 
+ * and vertex v. The edge is only stored here; build_adjacency
+ * makes the neighbor arrays once all edges are in.
  * 
  * @param u The vertex u.
  * @param v The vertex v.
  */
 void Tree::add_edge(int u, int v){
-  // Add v to u's adjacency list
-  neighbors[u].push_back(v);
-  // Undirected graph so v will also have u as a neighbor
-  neighbors[v].push_back(u);
+  edge_u[num_edges] = u;
+  edge_v[num_edges] = v;
+  num_edges++;
 }
 
 /**
- * void BFS
- * 
- * This is my implementation of the BFS. First it allocates memory
- * for the parents and distance arrays. Then it initializes all the
- * elements in the distance array to -1. A -1 is used as the value to 
- * indicate that the index associated with the vertex u has not been
- * visited. If the vertex is visited, then the index of the element 
- * will be set to > -1. A queue container is used to help with keeping
- * track of the visited vertices and an array called parents is used 
- * to keep track of the parent of vertex v. 
- * 
- * @param source The source or vertex to run BFS on.
+ * bool build_adjacency
+ *
+ * Builds the CSR neighbor arrays from the edges. The first pass counts
+ * the degrees and places every edge in both directions, in input order.
+ * The second pass walks those lists by vertex and appends u to the list
+ * of each neighbor v (the transpose). Vertices are visited in increasing
+ * order, so every list ends up sorted without calling sort (BFS needs
+ * the smallest neighbor first or it will print the wrong paths first).
+ *
+ * @return true The edges form a tree.
+ * @return false An edge closes a cycle (no arrays are built).
  */
-void Tree::BFS(int source){
-  // Dynamically allocated memory for the parent and distance array
-  parents = new int[num_vertices];
-  distance = new int[num_vertices];
+bool Tree::build_adjacency(){
+  if ((int) build_next.size() < num_vertices + 1){
+    build_next.resize(num_vertices + 1);
+  }
+  if ((int) build_unsorted.size() < 2 * num_edges){
+    build_unsorted.resize(2 * num_edges);
+  }
+  int* next = build_next.data();
+  int* unsorted = build_unsorted.data();
 
-  // Initialize the distance array to -1 for unvisited vertices
+  // n - 1 edges make a tree if none of them closes a cycle (union-find,
+  // with next as the set parents). The parallel BFS relies on it.
   for (int i = 0; i < num_vertices; i++){
-    distance[i] = -1;
+    next[i] = i;
+  }
+  for (int i = 0; i < num_edges; i++){
+    int a = edge_u[i];
+    int b = edge_v[i];
+    while (next[a] != a){
+      next[a] = next[next[a]];
+      a = next[a];
+    }
+    while (next[b] != b){
+      next[b] = next[next[b]];
+      b = next[b];
+    }
+    if (a == b){
+      return false;
+    }
+    next[a] = b;
   }
 
-  // Instiantiate a queue object for storing visited vertices
-  queue<int> q;
+  if (offsets == NULL){
+    offsets = new int[capacity + 1];
+    targets = new int[2 * capacity];
+  }
 
-  // Add one to the current source node (mark as visited)
-  distance[source] = distance[source] + 1;
+  // Pass 1: degrees, prefix sums, then the edges in input order
+  for (int i = 0; i <= num_vertices; i++){
+    offsets[i] = 0;
+  }
+  for (int i = 0; i < num_edges; i++){
+    offsets[edge_u[i] + 1]++;
+    offsets[edge_v[i] + 1]++;
+  }
+  for (int i = 0; i < num_vertices; i++){
+    offsets[i + 1] = offsets[i + 1] + offsets[i];
+  }
+  for (int i = 0; i <= num_vertices; i++){
+    next[i] = offsets[i];
+  }
+  for (int i = 0; i < num_edges; i++){
+    unsorted[next[edge_u[i]]++] = edge_v[i];
+    unsorted[next[edge_v[i]]++] = edge_u[i];
+  }
 
-  // Enqueue the source vertex at the end of the queue
-  q.push(source);
+  // Pass 2: the transpose comes out sorted
+  for (int i = 0; i <= num_vertices; i++){
+    next[i] = offsets[i];
+  }
+  for (int u = 0; u < num_vertices; u++){
+    for (int k = offsets[u]; k < offsets[u + 1]; k++){
+      targets[next[unsorted[k]]++] = u;
+    }
+  }
 
-  // Parent of source is itself
-  parents[source] = source;
+  if (!workspace){
+    vector<int>().swap(build_next);
+    vector<int>().swap(build_unsorted);
+    delete[] edge_u;
+    delete[] edge_v;
+    edge_u = NULL;
+    edge_v = NULL;
+  }
+  return true;
+}
 
-  // Sort the neighbors list (must or it will print the wrong paths first)
-  for (int i = 0; i < num_vertices; i++){
-    for (auto it = neighbors[i].begin(); it != neighbors[i].end();
-        it++){
-      neighbors[i].sort(less<int>());
-    }
+/**
+ * void benchmark_BFS
+ *
+ * Times runs BFS calls from different sources on the engine of the tree
+ * (with its threads), on a reused one-thread engine, and with a new
+ * one-thread engine for every call (allocating and initialising the
+ * buffers each time, like BFS used to). Reports BFS calls per second
+ * and edges per second of each to stderr.
+ *
+ * @param runs The number of BFS calls of each kind.
+ * @param num_threads The number of threads of the tree's engine.
+ */
+void Tree::benchmark_BFS(int runs, int num_threads){
+  if (runs < 1){
+    runs = 1;
   }
-  
-  while (!q.empty()){
-    // Get the value of the vertex in the front of the queue call it u
-    int u = q.front();
-    // Pop it from the queue
-    q.pop();
-    
-    // Check the current vertex's neighbors
-    for (auto it = neighbors[u].begin(); it != neighbors[u].end(); it++){
-      int v = *it;
-
-      // If neighbors distance -1, then we know that it has not been visted
-      if (distance[v] == -1){
-        // Enqueue the unvisited neighbor
-        q.push(v);
-        // Let the neighbor have a distance of plus 1 of u's 
-        // current distance; this also marks it as visited
-        distance[v] = distance[u] + 1;
-        // Update the parent's array, parent of v is u
-        parents[v] = u;
+  // The depth of every BFS has to come out the same in all three
+  long long checksum = 0;
+  BFS_engine serial(num_vertices, 1);
+  double seconds[3];
+  for (int kind = 0; kind < 3; kind++){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++){
+      int source = (int) ((long long) r * 7919 % num_vertices);
+      BFS_engine* bfs = (kind == 0) ? &engine : &serial;
+      if (kind == 2){
+        bfs = new BFS_engine(num_vertices, 1);
+      }
+      bfs->run(offsets, targets, source);
+      int depth = bfs->get_distance(bfs->get_visited(bfs->get_visited_count() - 1));
+      checksum = checksum + ((kind == 0) ? 2 * depth : -depth);
+      if (kind == 2){
+        delete bfs;
       }
     }
+    seconds[kind] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
   }
 
+  const char* names[3] = {"engine, threads:  ", "engine, 1 thread: ", "engine per call:  "};
+  cerr << num_vertices << " vertices, " << runs << " BFS calls, " << num_threads <<
+    " threads" << endl;
+  for (int kind = 0; kind < 3; kind++){
+    cerr << names[kind] << runs / seconds[kind] << " BFS/s, " <<
+      (double) runs * num_edges / seconds[kind] / 1e6 << " M edges/s" << endl;
+  }
+  if (checksum != 0){
+    cerr << "ERROR: the BFS kinds disagree." << endl;
+  }
+}
+
+/**
+ * void BFS
+ * 
+ * Runs BFS from source on the engine of this tree, which keeps the
+ * distance of every vertex from source and its parent on the path.
+ * The parent of source is itself.
+ * 
+ * @param source The source or vertex to run BFS on.
+ */
+void Tree::BFS(int source){
+  engine.run(offsets, targets, source);
+
   /* KEEP FOR DEBUGGING IN THE FUTURE */
   if (DEBUG){
     /* DEBUG: distance array */ 
     cout << "#### DISTANCE ARRAY ####" << endl;
     for (int i = 0; i < num_vertices; i++){
       cout << "Vertex <" << i << "> has distance = ";
-      cout << distance[i] << endl;
+      cout << engine.get_distance(i) << endl;
     }
     cout << endl;
     /* DEBUG: parents array */
     cout << "#### PARENTS ARRAY ####" << endl;
     for (int i = 0; i < num_vertices; i++){
       cout << "Parent of v <" << i << "> is: ";
-      cout << parents[i] << endl;
+      cout << engine.get_parent(i) << endl;
     }
     cout << endl;
     /* DEBUG: neighbors list */
     cout << "#### ADJACENCY LIST ####" << endl;
     for (int i = 0; i < num_vertices; i++){
-      int count = 0;
       cout << "Vertex <" << i << "> has neighbors: ";
-      for (auto it = neighbors[i].begin(); it != neighbors[i].end();
-        it++){
-        cout << *it;
-        list<int>::iterator end = neighbors[i].end();
-        count++;
-        if (count == *end){
+      for (int k = offsets[i]; k < offsets[i + 1]; k++){
+        cout << targets[k];
+        if (k + 1 == offsets[i + 1]){
           cout << " "; 
         }
         else{
@@ -181,19 +774,25 @@ void Tree::BFS(int source){
 /**
  * pair<int, int> find_longest_path
  *
- * This member function of the Tree class will iterate thru the 
- * distance array and find the largest value. 
+ * This member function of the Tree class finds the largest distance of
+ * the last BFS, and the smallest vertex at that distance. BFS reaches
+ * the vertices in order of distance, so only the last level (the end
+ * of the BFS order) has to be looked at.
  * 
  * @return vertex The vertex of which has the largest distance.
  * @return larger_distance The largest distance of the graph.
  */
 pair<int,int> Tree::find_longest_path(){
-  int larger_distance = 0;
-  int vertex;
-  for (int i = 0; i < num_vertices; i++){
-    if (distance[i] > larger_distance){
-      larger_distance = distance[i];
-      vertex = i;
+  int last = engine.get_visited_count() - 1;
+  int larger_distance = engine.get_distance(engine.get_visited(last));
+  int vertex = engine.get_visited(last);
+  for (int i = last; i >= 0; i--){
+    int v = engine.get_visited(i);
+    if (engine.get_distance(v) != larger_distance){
+      break;
+    }
+    if (v < vertex){
+      vertex = v;
     }
   }
   // Return the pair of vertex index and distance
@@ -210,7 +809,7 @@ pair<int,int> Tree::find_longest_path(){
  */
 int Tree::get_parent(int v){
   int u;
-  u = parents[v];
+  u = engine.get_parent(v);
 
   if (DEBUG){
     cout << "DEBUGGING::Get_parent(): parent of <" << v << ">";
@@ -220,96 +819,274 @@ int Tree::get_parent(int v){
 }
 
 /**
- * void reset_arrays
- * 
- * A member function to help reset the distance or parents array.
- * It basically deallocates the memory and resources that is pointed
- * to by the distance and parents variables.
+ * int get_distance
+ *
+ * @param v The vertex.
+ * @return The distance of v from the source of the last BFS.
  */
-void Tree::reset_arrays(){
-  delete[] distance;
-  delete[] parents;
+int Tree::get_distance(int v){
+  return engine.get_distance(v);
 }
 
 /**
- * void print
- * 
- * This member function prints the vertices to standard output.
- * A stack container is used to help with the lifo order. 
- * 
- * @param core The core vertex of the graph.
+ * int get_visited
+ *
+ * @param i The position in BFS order.
+ * @return The i-th vertex the last BFS reached.
  */
-void Tree::print(int core){
-  stack<int> print_stack;
-  int u;
-  int v = 0;
-  int count;
+int Tree::get_visited(int i){
+  return engine.get_visited(i);
+}
 
+/**
+ * void relabel
+ *
+ * Renumbers the vertices in the order the last BFS reached them, so a
+ * BFS from the same source (now vertex 0) and the DFS of print go
+ * through the arrays from front to back instead of all over them. The
+ * CSR arrays are made again in the new numbers, with the same transpose
+ * as build_adjacency (lists come out sorted); the BFS then reaches the
+ * vertices in the same order, so its queue is 0, 1, 2, ... The old
+ * numbers are kept in original for print.
+ */
+void Tree::relabel(){
+  vector<int> new_id(num_vertices);
   for (int i = 0; i < num_vertices; i++){
-    print_stack.push(i);
-    u = i;
-    count = 1;
-    if (core == i){
-      continue;
-    }
-    else{
-      for (int j = 0; j < distance[i]; j++){
-        v = get_parent(u);
-        print_stack.push(v);     
-        u = v;      
-        count++;
-      }
-      while (count != 0){
-        cout << print_stack.top() << " ";
-        print_stack.pop();
-        count--;
-      }
-      cout << endl;
+    new_id[engine.get_visited(i)] = i;
+  }
+  int* new_offsets = new int[capacity + 1];
+  int* new_targets = new int[2 * capacity];
+  new_offsets[0] = 0;
+  for (int w = 0; w < num_vertices; w++){
+    int u = engine.get_visited(w);
+    new_offsets[w + 1] = new_offsets[w] + offsets[u + 1] - offsets[u];
+  }
+  vector<int> next(new_offsets, new_offsets + num_vertices);
+  vector<int> renumbered(num_vertices);
+  for (int w = 0; w < num_vertices; w++){
+    int u = engine.get_visited(w);
+    for (int k = offsets[u]; k < offsets[u + 1]; k++){
+      new_targets[next[new_id[targets[k]]]++] = w;
     }
+    renumbered[w] = original.empty() ? u : original[u];
   }
+  delete[] offsets;
+  delete[] targets;
+  offsets = new_offsets;
+  targets = new_targets;
+  original.swap(renumbered);
 }
 
 /**
- * int main
+ * void set_labels
  *
- * The main function. This function instintiates a Tree object and 
- * asks the user for some inputs (number of vertices and (u, v) that 
- * will help connect the vertices to make a tree). BFS and other 
- * member functions will also be called to help determine the diameter
- * of the graph and find its core. Once all that is done, then it will 
- * call the member function print to print out the paths of the graph
- * starting from the core. 
+ * Makes print show labels[v] instead of v (NULL: v again); v is the
+ * number in the input, also after relabel.
+ *
+ * @param labels The label of every vertex.
+ */
+void Tree::set_labels(const unsigned long long* labels){
+  this->labels = labels;
+}
+
+/**
+ * int format_label
+ *
+ * Writes what print shows for v, and a space.
+ *
+ * @param v The vertex.
+ * @param out Where to write it (at least 21 chars).
+ * @return The number of chars written.
+ */
+int Tree::format_label(int v, char* out){
+  int input = original.empty() ? v : original[v];
+  return (labels == NULL) ? format_vertex(input, out) : format_id(labels[input], out);
+}
+
+/**
+ * void print
  * 
- * @return -1 Returns an error.
- * @return 0 Program executed with no problem. 
+ * This member function prints the vertices to standard output: for
+ * every vertex but the core, in order of vertex number, the path from
+ * the core to it (with the labels instead of the numbers, if set).
+ * After relabel, "vertex number" is the number in the input. It needs
+ * the BFS from the core (for the BFS order).
+ *
+ * The line of v is the line of its parent plus "v ", so the line
+ * lengths come from one pass in BFS order, and their prefix sums in
+ * vertex order give where each line goes in the output. A DFS from the
+ * core then keeps the current path, already formatted, in one buffer
+ * and copies it into the slot of every vertex it reaches. The output
+ * is made in windows of consecutive vertices (one DFS per window), each
+ * written with a single write.
+ * 
+ * @param core The core vertex of the graph.
+ * @param out Where to print.
  */
-int main(){
-  int u, v, i, num_vertices, source, core;
-  pair<int, int> first_endpoint, second_endpoint, core_endpoint;
+void Tree::print(int core, ostream &out){
+  print_windows(core, &out, NULL);
+}
 
-  // Prompt: enter the number of vertices
-  cin >> num_vertices;
+/**
+ * void print
+ *
+ * Same as the other print, but appends the output to text (batch mode
+ * keeps one text per thread, so it does not allocate for every tree).
+ *
+ * @param core The core vertex of the graph.
+ * @param text Where to append the output.
+ */
+void Tree::print(int core, string &text){
+  print_windows(core, NULL, &text);
+}
 
-  if (num_vertices == 0){
-    cerr << "ERROR: graph is empty." << endl;
-    return -1;
+/**
+ * void print_windows
+ *
+ * Does the work of print. Each window is made in place at the end of
+ * text, or in the print buffer and then written to out.
+ *
+ * @param core The core vertex of the graph.
+ * @param out Where to write the windows (NULL: append them to text).
+ * @param text Where to append the windows.
+ */
+void Tree::print_windows(int core, ostream* out, string* text){
+  if (engine.get_distance(core) != 0){
+    BFS(core);
   }
 
-  // Instantiate a Tree object
-  Tree tree(num_vertices);
+  // line_start[v] is the length of the line of v first, then (prefix
+  // sums) where it starts; the core has no line. Both are indexed by the
+  // number in the input (place).
+  const int* place = original.empty() ? NULL : original.data();
+  if (print_capacity < num_vertices){
+    delete[] print_line_start;
+    delete[] print_stack_vertex;
+    delete[] print_stack_edge;
+    delete[] print_stack_length;
+    print_capacity = num_vertices;
+    print_line_start = new long long[print_capacity + 1];
+    print_stack_vertex = new int[print_capacity];
+    print_stack_edge = new int[print_capacity];
+    print_stack_length = new long long[print_capacity];
+  }
+  long long* line_start = print_line_start;
+  char token[24];
+  long long max_line = 0;
+  for (int i = 0; i < engine.get_visited_count(); i++){
+    int v = engine.get_visited(i);
+    long long length = format_label(v, token);
+    if (v != core){
+      int p = get_parent(v);
+      length = length + line_start[(place == NULL) ? p : place[p]];
+    }
+    line_start[(place == NULL) ? v : place[v]] = length;
+    max_line = (length > max_line) ? length : max_line;
+  }
+  long long total = 0;
+  int core_place = (place == NULL) ? core : place[core];
+  for (int v = 0; v < num_vertices; v++){
+    long long length = (v == core_place) ? 0 : line_start[v] + 1;
+    line_start[v] = total;
+    total = total + length;
+  }
+  line_start[num_vertices] = total;
 
-  // Get user input and add edges to the u and v vertices
-  for (i = 0; i < (num_vertices-1); i++){
-    cin >> u >> v;
-    tree.add_edge(u, v);
+  long long window_limit = (long long) num_vertices * PRINT_BYTES_PER_VERTEX;
+  if (window_limit < PRINT_BUFFER_MIN){
+    window_limit = PRINT_BUFFER_MIN;
+  }
+  if ((long long) print_path.size() < max_line + 1){
+    print_path.resize(max_line + 1);
   }
+  char* path = print_path.data();
+  int* stack_vertex = print_stack_vertex;
+  int* stack_edge = print_stack_edge;
+  long long* stack_length = print_stack_length;
+
+  int lo = 0;
+  while (lo < num_vertices){
+    // The next window: at least one vertex, at most window_limit bytes
+    int hi = lo + 1;
+    while (hi < num_vertices && line_start[hi + 1] - line_start[lo] <= window_limit){
+      hi++;
+    }
+    long long window_bytes = line_start[hi] - line_start[lo];
+    char* buffer;
+    if (text != NULL){
+      size_t at = text->size();
+      text->resize(at + window_bytes);
+      buffer = &(*text)[at];
+    }
+    else{
+      if ((long long) print_buffer.size() < window_bytes){
+        print_buffer.resize(window_bytes);
+      }
+      buffer = print_buffer.data();
+    }
+
+    // DFS from the core, children smallest first
+    int depth = 0;
+    stack_vertex[0] = core;
+    stack_edge[0] = offsets[core];
+    stack_length[0] = format_label(core, path);
+    while (depth >= 0){
+      int u = stack_vertex[depth];
+      if (stack_edge[depth] == offsets[u + 1]){
+        depth--;
+        continue;
+      }
+      int v = targets[stack_edge[depth]++];
+      if (depth > 0 && v == stack_vertex[depth - 1]){
+        continue;
+      }
+      long long length = stack_length[depth] + format_label(v, path + stack_length[depth]);
+      depth++;
+      stack_vertex[depth] = v;
+      stack_edge[depth] = offsets[v];
+      stack_length[depth] = length;
+      int at = (place == NULL) ? v : place[v];
+      if (at >= lo && at < hi){
+        char* slot = buffer + (line_start[at] - line_start[lo]);
+        memcpy(slot, path, length);
+        slot[length] = '\n';
+      }
+    }
+
+    if (out != NULL){
+      out->write(buffer, window_bytes);
+    }
+    lo = hi;
+  }
+  if (out != NULL){
+    out->flush();
+  }
+}
+
+/**
+ * int find_core
+ *
+ * Finds the core of the tree: BFS from vertex 0 finds one end of a
+ * longest path (the diameter), BFS from that end finds the other end
+ * and the diameter D, and the core is D/2 steps back from the second
+ * end. Then it runs BFS from the core, which print and eccentricities
+ * use.
+ *
+ * @param diameter The address to the diameter D.
+ * @param distance_a If not NULL, gets the distances from the first end
+ *                   (for the eccentricities).
+ * @return The core vertex.
+ */
+int Tree::find_core(int &diameter, int* distance_a){
+  int source, core;
+  pair<int, int> first_endpoint, second_endpoint, core_endpoint;
 
   // User does not specify source so we are assuming source will begin
   // from index 0 or vertex 0
   source = 0;
-  tree.BFS(source);
+  BFS(source);
   // Get the first end_point
-  first_endpoint = tree.find_longest_path(); 
+  first_endpoint = find_longest_path(); 
   
   if (DEBUG){
     cout << endl;
@@ -317,9 +1094,6 @@ int main(){
     cout << ">" << endl;
   }
 
-  // Reset parents and distance arrays
-  tree.reset_arrays();
-
   if (DEBUG){
     cout << endl;
     cout << "----------Second Endpoint-----------" << endl;
@@ -327,8 +1101,13 @@ int main(){
   }
 
   // Now run bfs on the first endpoints vertex to get the second endpoint
-  tree.BFS(first_endpoint.first);
-  second_endpoint = tree.find_longest_path();
+  BFS(first_endpoint.first);
+  second_endpoint = find_longest_path();
+
+  // The eccentricities need these distances after the BFS from the core
+  if (distance_a != NULL){
+    copy_distances(distance_a);
+  }
 
   // Now we can find the core by dividing the diameter (longest path)
   // and divide it by 2
@@ -345,8 +1124,9 @@ int main(){
   }
 
   // Backtrace h edges from the second endpoint using parents array
+  core = end_point;
   for (int i = 0; i < h; i++){  
-    core = tree.get_parent(end_point);
+    core = get_parent(end_point);
     end_point = core;
   }
  
@@ -366,13 +1146,10 @@ int main(){
     cout << endl;
   }
 
-  // Reset the parent's and distance's arrays
-  tree.reset_arrays();
-
   // Run BFS on T and the core, use the parent's array to backtrace
   // paths from the core to each vertex in T and print it accordingly
-  tree.BFS(core);
-  core_endpoint = tree.find_longest_path();
+  BFS(core);
+  core_endpoint = find_longest_path();
  
   if (DEBUG){
     cout << endl;
@@ -381,8 +1158,1332 @@ int main(){
     cout << endl;
   }
 
+  diameter = second_endpoint.second;
+  return core;
+}
+
+/**
+ * int find_core_single_pass
+ *
+ * Finds the same endpoints, diameter and core as find_core, with one
+ * BFS instead of three. It leaves the BFS from 0 in the tree: run BFS
+ * from the core before print.
+ *
+ * The BFS from 0 roots the tree and gives the first endpoint a (the
+ * smallest of the deepest vertices). A height DP, one pass over the
+ * vertices leaves first (reverse BFS order), gives every vertex the
+ * deepest vertex of its subtree. A vertex w is d(a, x) + depth(w) -
+ * depth(x) from a, where x is where the path from w meets the path
+ * from a to 0, so going up from a and looking at the subtrees that
+ * hang off the path gives the second endpoint b (the smallest of the
+ * farthest from a) and the diameter. The core is floor(D/2) from b on
+ * the path between them, and the other center (if D is odd) one more.
+ *
+ * @param diameter The address to the diameter D.
+ * @param endpoints Where to put a and b (NULL if not needed).
+ * @param centers Where to put the core and, if D is odd, the other
+ * center (else -1) (NULL if not needed).
+ * @return The core.
+ */
+int Tree::find_core_single_pass(int &diameter, int* endpoints, int* centers){
+  BFS(0);
+  int a = find_longest_path().first;
+  int depth_a = engine.get_distance(a);
+
+  // The height DP; the deepest vertex of v is also its own depth
+  deepest.resize(num_vertices);
+  int* best = deepest.data();
+  for (int i = num_vertices - 1; i >= 0; i--){
+    int v = engine.get_visited(i);
+    best[v] = v;
+  }
+  for (int i = num_vertices - 1; i > 0; i--){
+    int v = engine.get_visited(i);
+    int p = engine.get_parent(v);
+    int depth_v = engine.get_distance(best[v]);
+    int depth_p = engine.get_distance(best[p]);
+    if (depth_v > depth_p || (depth_v == depth_p && best[v] < best[p])){
+      best[p] = best[v];
+    }
+  }
+
+  // Up from a: at x (depth depth_x), the vertices of the subtrees of the
+  // other children of x, and x itself, are depth_a - 2 depth_x + their
+  // depth from a
+  int b = a;
+  int depth_meet = depth_a; // Where the path from b meets the path from a to 0
+  int came_from = -1;
+  diameter = 0;
+  for (int x = a, depth_x = depth_a; depth_x >= 0; came_from = x, x = engine.get_parent(x),
+    depth_x--){
+    int here = depth_a - depth_x;
+    if (here > diameter || (here == diameter && x < b)){
+      diameter = here;
+      b = x;
+      depth_meet = depth_x;
+    }
+    for (int k = offsets[x]; k < offsets[x + 1]; k++){
+      int c = targets[k];
+      if (c == came_from || (depth_x > 0 && c == engine.get_parent(x))){
+        continue;
+      }
+      int far = depth_a - 2 * depth_x + engine.get_distance(best[c]);
+      if (far > diameter || (far == diameter && best[c] < b)){
+        diameter = far;
+        b = best[c];
+        depth_meet = depth_x;
+      }
+    }
+  }
+
+  // The vertex k from b on the path: up from b while on b's side, else
+  // up from a
+  int b_side = diameter - (depth_a - depth_meet); // Edges from b up to the meet
+  int h = diameter / 2;
+  int center[2] = {-1, -1};
+  for (int c = 0; c < 1 + diameter % 2; c++){
+    int k = h + c;
+    int v = (k <= b_side) ? b : a;
+    int steps = (k <= b_side) ? k : diameter - k;
+    for (int i = 0; i < steps; i++){
+      v = engine.get_parent(v);
+    }
+    center[c] = v;
+  }
+
+  if (DEBUG){
+    cout << "DEBUGGING::Endpoints are <" << a << "> and <" << b << ">, ";
+    cout << "diameter <" << diameter << ">, core <" << center[0] << ">" << endl;
+  }
+
+  if (endpoints != NULL){
+    endpoints[0] = a;
+    endpoints[1] = b;
+  }
+  if (centers != NULL){
+    centers[0] = center[0];
+    centers[1] = center[1];
+  }
+  return center[0];
+}
+
+/**
+ * void copy_distances
+ *
+ * Copies the distances of the last BFS, so they outlive the next one.
+ *
+ * @param out Where to copy them (num_vertices ints).
+ */
+void Tree::copy_distances(int* out){
+  for (int v = 0; v < num_vertices; v++){
+    out[v] = engine.get_distance(v);
+  }
+}
+
+/**
+ * void eccentricities
+ *
+ * The eccentricity (largest distance to any vertex) of every vertex,
+ * from two BFS that main runs anyway: from the first endpoint a of the
+ * diameter, and from the core c (the last BFS), which is floor(D/2)
+ * from the other endpoint b. ecc(v) = max(d(v, a), d(v, b)), and
+ * d(v, b) = d(v, c) + floor(D/2) whenever it can be larger than d(v, a)
+ * (the path from v to b goes through c unless v hangs off the diameter
+ * between c and b, and then a is the farther endpoint). So
+ * ecc(v) = max(d(v, a), d(v, c) + floor(D/2)).
+ *
+ * @param distance_a The distances from the first endpoint.
+ * @param diameter The diameter D.
+ * @param ecc Where to put the eccentricities (num_vertices ints).
+ */
+void Tree::eccentricities(int* distance_a, int diameter, int* ecc){
+  int h = diameter / 2;
+  for (int v = 0; v < num_vertices; v++){
+    int through_core = engine.get_distance(v) + h;
+    ecc[v] = (distance_a[v] > through_core) ? distance_a[v] : through_core;
+  }
+}
+
+/**
+ * void print_eccentricities
+ *
+ * Prints "radius R", then "centers" with every vertex whose
+ * eccentricity is the radius (one, or two next to each other), then
+ * "v ecc" for every vertex. The lines are formatted into one buffer.
+ *
+ * @param ecc The eccentricities.
+ */
+void Tree::print_eccentricities(int* ecc){
+  int radius = ecc[0];
+  for (int v = 1; v < num_vertices; v++){
+    radius = (ecc[v] < radius) ? ecc[v] : radius;
+  }
+
+  string out = "radius ";
+  char token[16];
+  out.append(token, format_vertex(radius, token) - 1);
+  out += "\ncenters";
+  for (int v = 0; v < num_vertices; v++){
+    if (ecc[v] == radius){
+      out += ' ';
+      out.append(token, format_vertex(v, token) - 1);
+    }
+  }
+  out += '\n';
+  out.reserve(out.size() + (size_t) num_vertices * 14);
+  for (int v = 0; v < num_vertices; v++){
+    out.append(token, format_vertex(v, token));
+    out.append(token, format_vertex(ecc[v], token) - 1);
+    out += '\n';
+  }
+  cout.write(out.data(), out.size());
+  cout.flush();
+}
+
+/**
+ * int check_eccentricities
+ *
+ * Runs BFS from samples vertices spread over the tree and checks that
+ * the deepest level is their eccentricity.
+ *
+ * @param ecc The eccentricities.
+ * @param samples The number of vertices to check.
+ * @return The number of vertices whose eccentricity is wrong.
+ */
+int Tree::check_eccentricities(int* ecc, int samples){
+  int wrong = 0;
+  for (int r = 0; r < samples; r++){
+    int v = (int) ((long long) r * 7919 % num_vertices);
+    engine.run(offsets, targets, v);
+    pair<int,int> farthest = find_longest_path();
+    if (farthest.second != ecc[v]){
+      wrong++;
+    }
+  }
+  return wrong;
+}
+
+/* Constructor: everything comes from the last BFS of the tree */
+Path_index::Path_index(Tree &tree, int num_vertices){
+  this->num_vertices = num_vertices;
+  depth.resize(num_vertices);
+  parent.resize(num_vertices);
+  pre.resize(num_vertices);
+  size.assign(num_vertices, 1);
+  order.resize(num_vertices);
+
+  // Subtree sizes, leaves first (reverse BFS order)
+  for (int i = num_vertices - 1; i >= 0; i--){
+    int v = tree.get_visited(i);
+    depth[v] = tree.get_distance(v);
+    parent[v] = tree.get_parent(v);
+    if (i > 0){
+      size[parent[v]] = size[parent[v]] + size[v];
+    }
+  }
+
+  // Preorder without a DFS: in BFS order, each child takes the next
+  // free place after its parent, and leaves room for its subtree.
+  // next_free (in order) is the next place for a child of v.
+  vector<int>& next_free = order;
+  int root = tree.get_visited(0);
+  pre[root] = 0;
+  next_free[root] = 1;
+  for (int i = 1; i < num_vertices; i++){
+    int v = tree.get_visited(i);
+    pre[v] = next_free[parent[v]];
+    next_free[parent[v]] = next_free[parent[v]] + size[v];
+    next_free[v] = pre[v] + 1;
+  }
+  for (int v = 0; v < num_vertices; v++){
+    order[pre[v]] = v;
+  }
+
+  // The sparse table
+  log2.assign(num_vertices + 1, 0);
+  for (int i = 2; i <= num_vertices; i++){
+    log2[i] = log2[i / 2] + 1;
+  }
+  table.resize(log2[num_vertices] + 1);
+  table[0] = order;
+  for (int j = 1; j < (int) table.size(); j++){
+    int half = 1 << (j - 1);
+    int count = num_vertices - (1 << j) + 1;
+    table[j].resize(count);
+    for (int i = 0; i < count; i++){
+      table[j][i] = shallower(table[j - 1][i], table[j - 1][i + half]);
+    }
+  }
+
+  // The vertices of every depth, in preorder (counting sort)
+  int height = 0;
+  for (int v = 0; v < num_vertices; v++){
+    height = (depth[v] > height) ? depth[v] : height;
+  }
+  depth_start.assign(height + 2, 0);
+  for (int v = 0; v < num_vertices; v++){
+    depth_start[depth[v] + 1]++;
+  }
+  for (int d = 0; d <= height; d++){
+    depth_start[d + 1] = depth_start[d + 1] + depth_start[d];
+  }
+  depth_pre.resize(num_vertices);
+  vector<int> fill(depth_start.begin(), depth_start.end() - 1);
+  for (int i = 0; i < num_vertices; i++){
+    depth_pre[fill[depth[order[i]]]++] = i;
+  }
+}
+
+/**
+ * int shallower
+ *
+ * @return Whichever of a and b is closer to the root.
+ */
+int Path_index::shallower(int a, int b){
+  return (depth[b] < depth[a]) ? b : a;
+}
+
+/**
+ * int lca
+ *
+ * The lowest common ancestor of u and v, in O(1): two overlapping
+ * ranges of the sparse table cover (pre[u], pre[v]].
+ *
+ * @return The LCA.
+ */
+int Path_index::lca(int u, int v){
+  if (u == v){
+    return u;
+  }
+  int left = pre[u];
+  int right = pre[v];
+  if (left > right){
+    int swap = left;
+    left = right;
+    right = swap;
+  }
+  left++;
+  int j = log2[right - left + 1];
+  int low = shallower(table[j][left], table[j][right - (1 << j) + 1]);
+  return parent[low];
+}
+
+/**
+ * int distance
+ *
+ * @return The number of edges between u and v.
+ */
+int Path_index::distance(int u, int v){
+  return depth[u] + depth[v] - 2 * depth[lca(u, v)];
+}
+
+/**
+ * bool is_ancestor
+ *
+ * @return Whether u is on the path from the root to v (u counts as its
+ * own ancestor).
+ */
+bool Path_index::is_ancestor(int u, int v){
+  return pre[u] <= pre[v] && pre[v] < pre[u] + size[u];
+}
+
+/**
+ * int ancestor_at_depth
+ *
+ * The ancestor of v at depth d, by binary search: the last vertex at
+ * depth d that comes before v in preorder.
+ *
+ * @param v The vertex.
+ * @param d The depth, at most depth[v].
+ * @return The ancestor.
+ */
+int Path_index::ancestor_at_depth(int v, int d){
+  int low = depth_start[d];
+  int high = depth_start[d + 1] - 1;
+  // The ancestor itself is in the list, so depth_pre[low] <= pre[v]
+  while (low < high){
+    int middle = low + (high - low + 1) / 2;
+    if (depth_pre[middle] <= pre[v]){
+      low = middle;
+    }
+    else{
+      high = middle - 1;
+    }
+  }
+  return order[depth_pre[low]];
+}
+
+/**
+ * int kth_on_path
+ *
+ * The k-th vertex on the path from u to v (u is the 0-th).
+ *
+ * @return The vertex, or -1 if the path has fewer than k + 1 vertices.
+ */
+int Path_index::kth_on_path(int u, int v, int k){
+  int w = lca(u, v);
+  int up = depth[u] - depth[w];
+  int length = up + depth[v] - depth[w];
+  if (k < 0 || k > length){
+    return -1;
+  }
+  if (k <= up){
+    return ancestor_at_depth(u, depth[u] - k);
+  }
+  return ancestor_at_depth(v, depth[v] - (length - k));
+}
+
+/**
+ * long long get_bytes
+ *
+ * @return The memory the index takes.
+ */
+long long Path_index::get_bytes(){
+  long long ints = 7LL * num_vertices + depth_start.size() + log2.size();
+  for (int j = 0; j < (int) table.size(); j++){
+    ints = ints + table[j].size();
+  }
+  return ints * (long long) sizeof(int);
+}
+
+/* Constructor: room for num_vertices IDs */
+ID_map::ID_map(int num_vertices){
+  this->num_vertices = num_vertices;
+  count = 0;
+  unsigned long long size = 2;
+  while (size * 3 < (unsigned long long) num_vertices * 4){
+    size = size * 2;
+  }
+  mask = size - 1;
+  table_id.resize(size);
+  table_first.assign(size, -1);
+}
+
+/**
+ * int insert
+ *
+ * @param id The ID of a vertex.
+ * @return The number of the ID (in the order the IDs were first seen),
+ * or -1 if it would be ID number num_vertices + 1.
+ */
+int ID_map::insert(unsigned long long id){
+  // The splitmix64 finalizer spreads IDs that differ in few bits
+  unsigned long long hash = id;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  hash = hash ^ (hash >> 31);
+  unsigned long long slot = hash & mask;
+  while (table_first[slot] >= 0){
+    if (table_id[slot] == id){
+      return table_first[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  if (count == num_vertices){
+    return -1;
+  }
+  table_id[slot] = id;
+  table_first[slot] = count;
+  return count++;
+}
+
+/**
+ * void sort_ids
+ *
+ * Sorts the distinct IDs (LSD radix sort, ID_RADIX_BITS a pass, skipping the
+ * passes where all IDs have the same digit) and frees the hash table.
+ * Vertex v is then the v-th smallest ID.
+ */
+void ID_map::sort_ids(){
+  vector<unsigned long long> key(count);
+  vector<int> first(count);
+  int k = 0;
+  for (size_t slot = 0; slot < table_first.size(); slot++){
+    if (table_first[slot] >= 0){
+      key[k] = table_id[slot];
+      first[k] = table_first[slot];
+      k++;
+    }
+  }
+  vector<unsigned long long>().swap(table_id);
+  vector<int>().swap(table_first);
+  vector<unsigned long long> key_next(count);
+  vector<int> first_next(count);
+
+  const int digits = 1 << ID_RADIX_BITS;
+  const unsigned long long digit_mask = digits - 1;
+  vector<int> bucket(digits + 1);
+  for (int shift = 0; shift < 64; shift = shift + ID_RADIX_BITS){
+    bucket.assign(digits + 1, 0);
+    for (int i = 0; i < count; i++){
+      bucket[((key[i] >> shift) & digit_mask) + 1]++;
+    }
+    if (count > 0 && bucket[((key[0] >> shift) & digit_mask) + 1] == count){
+      continue;
+    }
+    for (int d = 0; d < digits; d++){
+      bucket[d + 1] = bucket[d + 1] + bucket[d];
+    }
+    for (int i = 0; i < count; i++){
+      int place = bucket[(key[i] >> shift) & digit_mask]++;
+      key_next[place] = key[i];
+      first_next[place] = first[i];
+    }
+    key.swap(key_next);
+    first.swap(first_next);
+  }
+
+  vector<unsigned long long>().swap(key_next);
+  vector<int>().swap(first_next);
+  rank.resize(count);
+  for (int v = 0; v < count; v++){
+    rank[first[v]] = v;
+  }
+  ids.swap(key);
+}
+
+/**
+ * int get_rank
+ *
+ * @param first_seen The number insert gave an ID.
+ * @return Its vertex, after sort_ids.
+ */
+int ID_map::get_rank(int first_seen){
+  return rank[first_seen];
+}
+
+/**
+ * int get_count
+ *
+ * @return The number of distinct IDs.
+ */
+int ID_map::get_count(){
+  return count;
+}
+
+/**
+ * unsigned long long* get_ids
+ *
+ * @return The ID of every vertex, after sort_ids.
+ */
+unsigned long long* ID_map::get_ids(){
+  return ids.data();
+}
+
+/**
+ * int format_vertex
+ *
+ * Writes the vertex number and a space, the way print shows a vertex.
+ *
+ * @param v The vertex.
+ * @param out Where to write it (at least 12 chars).
+ * @return The number of chars written.
+ */
+int format_vertex(int v, char* out){
+  char digits[12];
+  int count = 0;
+  do{
+    digits[count++] = (char) ('0' + v % 10);
+    v = v / 10;
+  } while (v > 0);
+  for (int i = 0; i < count; i++){
+    out[i] = digits[count - 1 - i];
+  }
+  out[count] = ' ';
+  return count + 1;
+}
+
+/**
+ * int format_id
+ *
+ * format_vertex for a 64-bit ID.
+ *
+ * @param id The ID.
+ * @param out Where to write it (at least 21 chars).
+ * @return The number of chars written.
+ */
+int format_id(unsigned long long id, char* out){
+  char digits[20];
+  int count = 0;
+  do{
+    digits[count++] = (char) ('0' + id % 10);
+    id = id / 10;
+  } while (id > 0);
+  for (int i = 0; i < count; i++){
+    out[i] = digits[count - 1 - i];
+  }
+  out[count] = ' ';
+  return count + 1;
+}
+
+/**
+ * void read_all_text
+ *
+ * Reads the rest of the input, in big chunks.
+ *
+ * @param in The input.
+ * @param text Where to put it.
+ */
+void read_all_text(istream &in, string &text){
+  vector<char> chunk(1 << 20);
+  text.clear();
+  while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0){
+    text.append(chunk.data(), in.gcount());
+  }
+}
+
+/**
+ * bool next_int
+ *
+ * Parses the integer that starts at text[i], after any whitespace.
+ *
+ * @param text The text.
+ * @param i Where to start; moved past the integer.
+ * @param value Where to put the integer.
+ * @return Whether there was one (i is left at whatever was there
+ * instead, or at the end of text).
+ */
+bool next_int(const string &text, size_t &i, int &value){
+  while (i < text.size() && (text[i] == ' ' || text[i] == '\n' || text[i] == '\t' ||
+    text[i] == '\r')){
+    i++;
+  }
+  size_t start = i;
+  bool negative = (i < text.size() && text[i] == '-');
+  if (negative){
+    i++;
+  }
+  if (i >= text.size() || text[i] < '0' || text[i] > '9'){
+    i = start;
+    return false;
+  }
+  long long number = 0;
+  while (i < text.size() && text[i] >= '0' && text[i] <= '9'){
+    number = number * 10 + (text[i] - '0');
+    if (number > 2147483647LL){
+      i = start;
+      return false;
+    }
+    i++;
+  }
+  value = (int) (negative ? -number : number);
+  return true;
+}
+
+/**
+ * bool parse_id
+ *
+ * Parses a vertex ID: only the digits of a number from 0 to 2^64 - 1.
+ * A sign (so "-7", which cin would wrap), any other character and an
+ * overflow are all rejected.
+ *
+ * @param word The word.
+ * @param id Where to put the ID.
+ * @return Whether word is an ID.
+ */
+bool parse_id(const string &word, unsigned long long &id){
+  if (word.empty()){
+    return false;
+  }
+  id = 0;
+  for (size_t i = 0; i < word.size(); i++){
+    if (word[i] < '0' || word[i] > '9'){
+      return false;
+    }
+    unsigned long long digit = word[i] - '0';
+    if (id > (~0ULL - digit) / 10){
+      return false;
+    }
+    id = id * 10 + digit;
+  }
+  return true;
+}
+
+/**
+ * int read_all_ints
+ *
+ * Reads every integer of the input (whitespace separated) in one go
+ * and with a hand-written parser.
+ *
+ * @param in The input.
+ * @param values The address to the integers.
+ * @return 1 The input only had integers.
+ * @return 0 Something else was in the input.
+ */
+int read_all_ints(istream &in, vector<int> &values){
+  string text;
+  read_all_text(in, text);
+  size_t i = 0;
+  int value;
+  values.clear();
+  while (next_int(text, i, value)){
+    values.push_back(value);
+  }
+  // Only whitespace may be left
+  return i >= text.size();
+}
+
+/**
+ * int run_batch
+ *
+ * Batch mode: the input is any number of trees one after the other, each
+ * in the usual format (n, then n - 1 edges). The trees are handed out to
+ * num_threads threads, each with one Tree that is reset for every tree
+ * (so its arrays and buffers are only reallocated for a bigger tree) and
+ * one output text. A tree that is next in input order is written
+ * straight from that text; one that finishes early is moved into its
+ * slot until the trees before it are written. Whichever thread writes a
+ * tree also writes every tree after it that is already done, so the
+ * output is in input order.
+ *
+ * The benchmark discards the output and reports trees per second.
+ *
+ * @param benchmark Whether to only time the batch.
+ * @param num_threads The number of threads.
+ * @return -1 Returns an error (bad input; the trees before it are printed).
+ * @return 0 Program executed with no problem.
+ */
+int run_batch(bool benchmark, int num_threads){
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<int> values;
+  if (!read_all_ints(cin, values)){
+    cerr << "ERROR: the input is not all integers." << endl;
+    return -1;
+  }
+
+  // Where every tree starts; a tree that is cut short ends the batch
+  vector<int> tree_start;
+  string error = "";
+  size_t pos = 0;
+  while (pos < values.size()){
+    int n = values[pos];
+    if (n <= 0){
+      error = "graph is empty";
+      break;
+    }
+    if ((long long) values.size() - (long long) pos - 1 < 2LL * (n - 1)){
+      error = "tree is cut short";
+      break;
+    }
+    tree_start.push_back((int) pos);
+    pos = pos + 1 + 2 * (size_t) (n - 1);
+  }
+  int num_trees = (int) tree_start.size();
+  double read_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  vector<string> outputs(num_trees);
+  vector<int> status(num_trees, 0); // 0 not done, 1 done, -1 bad tree
+  int next_out = 0;
+  int bad_tree = -1;
+  mutex out_lock;
+  atomic<int> next_tree(0);
+  long long out_bytes = 0;
+
+  run_threads(num_threads, [&](int){
+    Tree tree(1, 1);
+    string text; // The output of one tree; keeps its room for the next
+    int k;
+    while ((k = next_tree.fetch_add(1)) < num_trees){
+      const int* record = values.data() + tree_start[k];
+      int n = record[0];
+      bool ok = true;
+      tree.reset(n);
+      for (int e = 0; e < n - 1 && ok; e++){
+        int u = record[1 + 2 * e];
+        int v = record[2 + 2 * e];
+        ok = (u >= 0 && u < n && v >= 0 && v < n);
+        tree.add_edge(u, v);
+      }
+      text.clear();
+      if (ok && tree.build_adjacency()){
+        int diameter;
+        int core = tree.find_core_single_pass(diameter, NULL, NULL);
+        tree.BFS(core);
+        tree.print(core, text);
+      }
+      else{
+        ok = false;
+      }
+
+      // Write this tree if it is next, else keep it until it is; then
+      // write the ones after it that are done, in order
+      lock_guard<mutex> guard(out_lock);
+      status[k] = ok ? 1 : -1;
+      if (ok && k == next_out && bad_tree < 0){
+        out_bytes = out_bytes + text.size();
+        if (!benchmark){
+          cout.write(text.data(), text.size());
+        }
+        next_out++;
+      }
+      else if (ok){
+        outputs[k].swap(text);
+      }
+      while (next_out < num_trees && status[next_out] != 0 && bad_tree < 0){
+        if (status[next_out] < 0){
+          bad_tree = next_out;
+          break;
+        }
+        out_bytes = out_bytes + outputs[next_out].size();
+        if (!benchmark){
+          cout.write(outputs[next_out].data(), outputs[next_out].size());
+        }
+        string().swap(outputs[next_out]);
+        next_out++;
+      }
+    }
+  });
+  cout.flush();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  if (bad_tree >= 0){
+    cerr << "ERROR: tree " << bad_tree << " of the batch is not a tree." << endl;
+    return -1;
+  }
+  if (error != ""){
+    cerr << "ERROR: " << error << " (after " << num_trees << " trees)." << endl;
+    return -1;
+  }
+  if (benchmark){
+    cerr << num_trees << " trees, " << values.size() << " numbers, " << num_threads <<
+      " threads" << endl;
+    cerr << "read: " << read_seconds << " s, total: " << seconds << " s, " <<
+      num_trees / seconds << " trees/s, " << out_bytes << " bytes of output" << endl;
+  }
+  return 0;
+}
+
+/**
+ * int run_queries
+ *
+ * Query mode: after the tree, the input has any number of queries, one
+ * per line, on the tree rooted at the core:
+ *   d u v    the distance between u and v
+ *   l u v    their lowest common ancestor
+ *   a u v    1 if u is an ancestor of v (or v itself), else 0
+ *   k u v K  the K-th vertex on the path from u to v (u is the 0-th),
+ *            or -1 if the path is shorter
+ * (only the first letter of the word counts, so "dist" works too). All
+ * queries are read first, answered on num_threads threads with a
+ * Path_index, and printed one answer per line with a single write.
+ *
+ * @param tree The tree, with the BFS from the core as its last BFS.
+ * @param num_vertices The number of vertices.
+ * @param num_threads The number of threads.
+ * @return -1 Returns an error (bad query).
+ * @return 0 Program executed with no problem.
+ */
+int run_queries(Tree &tree, int num_vertices, int num_threads){
+  string text;
+  read_all_text(cin, text);
+  vector<char> type;
+  vector<int> args; // u, v, K of every query
+  size_t i = 0;
+  while (true){
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\n' || text[i] == '\t' ||
+      text[i] == '\r')){
+      i++;
+    }
+    if (i >= text.size()){
+      break;
+    }
+    char c = text[i];
+    while (i < text.size() && text[i] >= 'a' && text[i] <= 'z'){
+      i++;
+    }
+    int u, v, k = 0;
+    if ((c != 'd' && c != 'l' && c != 'a' && c != 'k') || !next_int(text, i, u) ||
+      !next_int(text, i, v) || (c == 'k' && !next_int(text, i, k))){
+      cerr << "ERROR: bad query " << type.size() << "." << endl;
+      return -1;
+    }
+    if (u < 0 || u >= num_vertices || v < 0 || v >= num_vertices){
+      cerr << "ERROR: vertex out of range in query " << type.size() << "." << endl;
+      return -1;
+    }
+    type.push_back(c);
+    args.push_back(u);
+    args.push_back(v);
+    args.push_back(k);
+  }
+
+  Path_index index(tree, num_vertices);
+  int num_queries = (int) type.size();
+  vector<int> answer(num_queries);
+  run_threads(num_threads, [&](int t){
+    int first = (int) ((long long) num_queries * t / num_threads);
+    int last = (int) ((long long) num_queries * (t + 1) / num_threads);
+    for (int q = first; q < last; q++){
+      int u = args[3 * q];
+      int v = args[3 * q + 1];
+      if (type[q] == 'd'){
+        answer[q] = index.distance(u, v);
+      }
+      else if (type[q] == 'l'){
+        answer[q] = index.lca(u, v);
+      }
+      else if (type[q] == 'a'){
+        answer[q] = index.is_ancestor(u, v) ? 1 : 0;
+      }
+      else{
+        answer[q] = index.kth_on_path(u, v, args[3 * q + 2]);
+      }
+    }
+  });
+
+  string out;
+  out.reserve((size_t) num_queries * 8);
+  char token[16];
+  for (int q = 0; q < num_queries; q++){
+    if (answer[q] < 0){
+      out += "-1\n";
+      continue;
+    }
+    int length = format_vertex(answer[q], token);
+    token[length - 1] = '\n';
+    out.append(token, length);
+  }
+  cout.write(out.data(), out.size());
+  cout.flush();
+  return 0;
+}
+
+/**
+ * int benchmark_queries
+ *
+ * Times building the Path_index and count random queries of each kind,
+ * then checks a few sources against a BFS of their own: every distance,
+ * and the middle vertex of every path.
+ *
+ * @param tree The tree, with the BFS from the core as its last BFS.
+ * @param num_vertices The number of vertices.
+ * @param count The number of queries of each kind.
+ * @param num_threads The number of threads.
+ * @return -1 Returns an error (a wrong answer).
+ * @return 0 Program executed with no problem.
+ */
+int benchmark_queries(Tree &tree, int num_vertices, int count, int num_threads){
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Path_index index(tree, num_vertices);
+  double build_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cerr << num_vertices << " vertices, index: " << build_seconds << " s, " <<
+    index.get_bytes() / 1048576.0 << " MB" << endl;
+
+  const char* names[4] = {"distance", "lca", "ancestor", "k-th on path"};
+  for (int kind = 0; kind < 4; kind++){
+    atomic<long long> checksum(0);
+    start = chrono::steady_clock::now();
+    run_threads(num_threads, [&](int t){
+      unsigned int seed = 12345u + 977u * t;
+      long long sum = 0;
+      int first = (int) ((long long) count * t / num_threads);
+      int last = (int) ((long long) count * (t + 1) / num_threads);
+      for (int q = first; q < last; q++){
+        seed = seed * 1103515245u + 12345u;
+        int u = (int) (seed % num_vertices);
+        seed = seed * 1103515245u + 12345u;
+        int v = (int) (seed % num_vertices);
+        if (kind == 0){
+          sum = sum + index.distance(u, v);
+        }
+        else if (kind == 1){
+          sum = sum + index.lca(u, v);
+        }
+        else if (kind == 2){
+          sum = sum + (index.is_ancestor(u, v) ? 1 : 0);
+        }
+        else{
+          sum = sum + index.kth_on_path(u, v, (int) (seed >> 8) % 8);
+        }
+      }
+      checksum += sum;
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << names[kind] << ": " << count / seconds / 1e6 << " M queries/s (checksum " <<
+      checksum << ")" << endl;
+  }
+
+  // The BFS of a source gives every distance; the middle vertex of the
+  // path to v is at distance k from the source and length - k from v
+  int wrong = 0;
+  int sources = (num_vertices < 5) ? num_vertices : 5;
+  for (int r = 0; r < sources; r++){
+    int u = (int) ((long long) r * 7919 % num_vertices);
+    tree.BFS(u);
+    for (int v = 0; v < num_vertices; v++){
+      int length = tree.get_distance(v);
+      int middle = index.kth_on_path(u, v, length / 2);
+      if (index.distance(u, v) != length || middle < 0 ||
+        tree.get_distance(middle) != length / 2 ||
+        index.distance(middle, v) != length - length / 2 ||
+        index.kth_on_path(u, v, length + 1) != -1){
+        wrong++;
+      }
+    }
+  }
+  if (wrong > 0){
+    cerr << "ERROR: " << wrong << " answers are wrong." << endl;
+    return -1;
+  }
+  cerr << "checked all paths from " << sources << " sources" << endl;
+  return 0;
+}
+
+/**
+ * int run_ids
+ *
+ * The paths of a tree whose vertices are any 64-bit IDs (the input is n,
+ * then n - 1 edges of two IDs). The IDs are unsigned, from 0 to 2^64 - 1;
+ * an ID with a '-' or anything else but digits is an error (see
+ * parse_id). The IDs are mapped to 0..n-1 in ID order (see ID_map), the
+ * tree is solved as usual, and print shows the IDs again.
+ *
+ * @param num_threads The number of threads.
+ * @return -1 Returns an error.
+ * @return 0 Program executed with no problem.
+ */
+int run_ids(int num_threads){
+  int num_vertices;
+  cin >> num_vertices;
+  if (num_vertices <= 0){
+    cerr << "ERROR: graph is empty." << endl;
+    return -1;
+  }
+
+  ID_map map(num_vertices);
+  vector<int> ends(2 * (size_t) (num_vertices - 1));
+  for (size_t i = 0; i < ends.size(); i++){
+    string word;
+    unsigned long long id;
+    if (!(cin >> word)){
+      cerr << "ERROR: the input has fewer than " << num_vertices - 1 << " edges." << endl;
+      return -1;
+    }
+    if (!parse_id(word, id)){
+      cerr << "ERROR: " << word << " is not a vertex ID (0 to 2^64 - 1)." << endl;
+      return -1;
+    }
+    ends[i] = map.insert(id);
+    if (ends[i] < 0){
+      cerr << "ERROR: the edges have more than " << num_vertices << " IDs." << endl;
+      return -1;
+    }
+  }
+  if (num_vertices > 1 && map.get_count() != num_vertices){
+    cerr << "ERROR: the edges do not form a tree." << endl;
+    return -1;
+  }
+  map.sort_ids();
+
+  Tree tree(num_vertices, num_threads);
+  for (size_t i = 0; i < ends.size(); i = i + 2){
+    tree.add_edge(map.get_rank(ends[i]), map.get_rank(ends[i + 1]));
+  }
+  vector<int>().swap(ends);
+  if (!tree.build_adjacency()){
+    cerr << "ERROR: the edges do not form a tree." << endl;
+    return -1;
+  }
+
+  int diameter;
+  int core = tree.find_core_single_pass(diameter, NULL, NULL);
+  tree.BFS(core);
+  if (num_vertices >= RELABEL_MIN_VERTICES){
+    tree.relabel();
+    core = 0;
+    tree.BFS(core);
+  }
+  if (num_vertices > 1){
+    tree.set_labels(map.get_ids());
+  }
+  tree.print(core, cout);
+  return 0;
+}
+
+/**
+ * int benchmark_ids
+ *
+ * Times mapping the IDs of a random tree with num_edges edges whose
+ * vertex IDs are spread over all 64 bits: the hash table pass over both
+ * ends of every edge, the sort, and renumbering the ends. The IDs are
+ * made on the fly from the vertex numbers (with a bijection), so no
+ * input is kept in memory. Then checks the sorted IDs and some ends.
+ *
+ * @param num_edges The number of edges.
+ * @return -1 Returns an error (a wrong mapping).
+ * @return 0 Program executed with no problem.
+ */
+int benchmark_ids(long long num_edges){
+  if (num_edges < 1 || num_edges > 2147483646LL){
+    cerr << "ERROR: the number of edges must be 1 to 2147483646." << endl;
+    return -1;
+  }
+  int num_vertices = (int) num_edges + 1;
+  // A bijection of 64-bit numbers (odd multiplier, xor-shift)
+  struct Spread{
+    static unsigned long long id(int v){
+      unsigned long long x = (unsigned long long) v * 0x9e3779b97f4a7c15ULL;
+      return x ^ (x >> 29);
+    }
+  };
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  ID_map map(num_vertices);
+  vector<int> ends(2 * (size_t) num_edges);
+  unsigned int seed = 12345;
+  for (int v = 1; v < num_vertices; v++){
+    seed = seed * 1103515245u + 12345u;
+    int parent = (int) (seed % (unsigned int) v);
+    ends[2 * (size_t) (v - 1)] = map.insert(Spread::id(parent));
+    ends[2 * (size_t) (v - 1) + 1] = map.insert(Spread::id(v));
+  }
+  double hash_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  start = chrono::steady_clock::now();
+  map.sort_ids();
+  double sort_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  start = chrono::steady_clock::now();
+  for (size_t i = 0; i < ends.size(); i++){
+    ends[i] = map.get_rank(ends[i]);
+  }
+  double rank_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  double seconds = hash_seconds + sort_seconds + rank_seconds;
+
+  cerr << num_edges << " edges, " << map.get_count() << " IDs" << endl;
+  cerr << "hash table: " << hash_seconds << " s, sort: " << sort_seconds <<
+    " s, renumber: " << rank_seconds << " s" << endl;
+  cerr << "total: " << seconds << " s, " << num_edges / seconds / 1e6 << " M edges/s" <<
+    endl;
+
+  unsigned long long* ids = map.get_ids();
+  int wrong = (map.get_count() == num_vertices) ? 0 : 1;
+  for (int v = 1; v < map.get_count(); v++){
+    wrong = wrong + ((ids[v - 1] < ids[v]) ? 0 : 1);
+  }
+  for (int v = 1; v < num_vertices; v = v + 1 + v / 1000){
+    wrong = wrong + ((ids[ends[2 * (size_t) (v - 1) + 1]] == Spread::id(v)) ? 0 : 1);
+  }
+  if (wrong > 0){
+    cerr << "ERROR: " << wrong << " IDs are mapped wrong." << endl;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * int main
+ *
+ * The main function. This function instintiates a Tree object and 
+ * asks the user for some inputs (number of vertices and (u, v) that 
+ * will help connect the vertices to make a tree). BFS and other 
+ * member functions will also be called to help determine the diameter
+ * of the graph and find its core. Once all that is done, then it will 
+ * call the member function print to print out the paths of the graph
+ * starting from the core. 
+ *
+ * "-threads N" sets the number of threads of the BFS (default: the
+ * number of cores). With "-bench [RUNS] [THREADS]" it reads the tree the
+ * same way, then only times RUNS BFS calls (default 100) and reports
+ * them to stderr. "-ecc" prints the radius, the centers and the
+ * eccentricity of every vertex instead of the paths, and
+ * "-ecc-bench [SAMPLES]" times that and checks SAMPLES vertices (default
+ * 100) with a BFS of their own. "-batch" reads any number of trees, one
+ * after the other, and prints the paths of each (see run_batch);
+ * "-batch-bench" only reports how many trees per second that makes.
+ * "-query" reads distance, ancestor and path queries after the tree
+ * (see run_queries); "-query-bench [COUNT]" times COUNT random queries
+ * of each kind (default 1000000). "-core-bench" times find_core against
+ * find_core_single_pass and checks that they find the same core.
+ * "-ids" takes any unsigned 64-bit vertex IDs instead of 0..n-1 (see
+ * run_ids; a '-' is rejected), and "-ids-bench [EDGES]" times mapping
+ * the IDs of EDGES edges (default 10000000). "-relabel-bench" times the last BFS and print with
+ * and without Tree::relabel.
+ * 
+ * @return -1 Returns an error.
+ * @return 0 Program executed with no problem. 
+ */
+int main(int argc, char *argv[]){
+  int u, v, i, num_vertices, core, diameter;
+  int num_threads = (int) thread::hardware_concurrency();
+  vector<string> args;
+
+  // "-threads N" can go anywhere, the rest is the mode and its arguments
+  for (i = 1; i < argc; i++){
+    if (string(argv[i]) == "-threads" && i + 1 < argc){
+      num_threads = atoi(argv[++i]);
+    }
+    else{
+      args.push_back(argv[i]);
+    }
+  }
+  string mode = args.empty() ? "" : args[0];
+  if (mode == "-bench" && args.size() > 2){
+    num_threads = atoi(args[2].c_str());
+  }
+  if (mode != "" && mode != "-bench" && mode != "-ecc" && mode != "-ecc-bench" &&
+    mode != "-batch" && mode != "-batch-bench" && mode != "-query" &&
+    mode != "-query-bench" && mode != "-core-bench" && mode != "-ids" &&
+    mode != "-ids-bench" && mode != "-relabel-bench"){
+    cerr << "ERROR: unknown mode <" << mode << ">." << endl;
+    return -1;
+  }
+  if (num_threads < 1){
+    num_threads = 1;
+  }
+
+  // Many trees, one after the other
+  if (mode == "-batch" || mode == "-batch-bench"){
+    return run_batch(mode == "-batch-bench", num_threads);
+  }
+
+  // Sparse 64-bit vertex IDs
+  if (mode == "-ids"){
+    return run_ids(num_threads);
+  }
+  if (mode == "-ids-bench"){
+    return benchmark_ids((args.size() > 1) ? atoll(args[1].c_str()) : 10000000LL);
+  }
+
+  // Prompt: enter the number of vertices
+  cin >> num_vertices;
+
+  if (num_vertices == 0){
+    cerr << "ERROR: graph is empty." << endl;
+    return -1;
+  }
+
+  // Instantiate a Tree object
+  Tree tree(num_vertices, num_threads);
+
+  // Get user input and add edges to the u and v vertices
+  for (i = 0; i < (num_vertices-1); i++){
+    cin >> u >> v;
+    if (u < 0 || u >= num_vertices || v < 0 || v >= num_vertices){
+      cerr << "ERROR: vertex out of range." << endl;
+      return -1;
+    }
+    tree.add_edge(u, v);
+  }
+
+  // All edges are in, make the (sorted) neighbor arrays
+  if (!tree.build_adjacency()){
+    cerr << "ERROR: the edges do not form a tree." << endl;
+    return -1;
+  }
+
+  if (mode == "-bench"){
+    tree.benchmark_BFS(args.size() > 1 ? atoi(args[1].c_str()) : 100, num_threads);
+    return 0;
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  if (mode == "-core-bench"){
+    int endpoints[2], centers[2], single_diameter;
+    core = tree.find_core(diameter, NULL);
+    double bfs_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    int single_core = tree.find_core_single_pass(single_diameter, endpoints, centers);
+    double single_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << num_vertices << " vertices, endpoints " << endpoints[0] << " " << endpoints[1] <<
+      ", diameter " << single_diameter << ", centers " << centers[0];
+    if (centers[1] >= 0){
+      cerr << " " << centers[1];
+    }
+    cerr << endl;
+    cerr << "3 BFS: " << bfs_seconds << " s, 1 BFS and the height DP: " << single_seconds <<
+      " s" << endl;
+    if (single_core != core || single_diameter != diameter){
+      cerr << "ERROR: the single pass found core " << single_core << ", not " << core << "." <<
+        endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  if (mode == "-relabel-bench"){
+    // The output is made but not written
+    ostream discard(NULL);
+    core = tree.find_core_single_pass(diameter, NULL, NULL);
+    double times[5];
+    // BFS and print in the input numbers, relabel, BFS and print again
+    for (int step = 0; step < 5; step++){
+      start = chrono::steady_clock::now();
+      if (step == 0 || step == 3){
+        tree.BFS(core);
+      }
+      else if (step == 1 || step == 4){
+        tree.print(core, discard);
+      }
+      else{
+        tree.relabel();
+        core = 0;
+      }
+      times[step] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    cerr << num_vertices << " vertices" << endl;
+    cerr << "input order: BFS " << times[0] << " s, print " << times[1] << " s" << endl;
+    cerr << "relabeled: relabel " << times[2] << " s, BFS " << times[3] << " s, print " <<
+      times[4] << " s" << endl;
+    return 0;
+  }
+
+  // Find the core. The eccentricities (and the queries) also need the
+  // BFS from the first endpoint, so they use the three BFS; the paths
+  // only need one BFS from the core, after a single pass.
+  vector<int> distance_a;
+  if (mode == "-ecc" || mode == "-ecc-bench"){
+    distance_a.resize(num_vertices);
+  }
+  if (mode == ""){
+    core = tree.find_core_single_pass(diameter, NULL, NULL);
+    tree.BFS(core);
+    if (num_vertices >= RELABEL_MIN_VERTICES){
+      tree.relabel();
+      core = 0;
+      tree.BFS(core);
+    }
+  }
+  else{
+    core = tree.find_core(diameter, distance_a.empty() ? NULL : distance_a.data());
+  }
+
+  if (mode == "-ecc" || mode == "-ecc-bench"){
+    vector<int> ecc(num_vertices);
+    tree.eccentricities(distance_a.data(), diameter, ecc.data());
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (mode == "-ecc"){
+      tree.print_eccentricities(ecc.data());
+      return 0;
+    }
+    int samples = (args.size() > 1) ? atoi(args[1].c_str()) : 100;
+    samples = (samples > num_vertices) ? num_vertices : samples;
+    start = chrono::steady_clock::now();
+    int wrong = tree.check_eccentricities(ecc.data(), samples);
+    double check_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << num_vertices << " vertices, diameter " << diameter << endl;
+    cerr << "all eccentricities (3 BFS): " << seconds << " s, " <<
+      num_vertices / seconds / 1e6 << " M vertices/s" << endl;
+    cerr << "one BFS per vertex: " << check_seconds / (samples > 0 ? samples : 1) <<
+      " s per vertex (" << samples << " checked)" << endl;
+    if (wrong > 0){
+      cerr << "ERROR: " << wrong << " eccentricities are wrong." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  if (mode == "-query"){
+    return run_queries(tree, num_vertices, num_threads);
+  }
+  if (mode == "-query-bench"){
+    int count = (args.size() > 1) ? atoi(args[1].c_str()) : 1000000;
+    return benchmark_queries(tree, num_vertices, count, num_threads);
+  }
+
   // Print the paths
-  tree.print(core);
+  tree.print(core, cout);
 
   return 0;
 }
@@ -18,33 +18,628 @@
 #include <vector>
 #include <sstream>
 #include <string>
+#include <chrono>   // For timing the benchmark modes
+#include <iterator> // For istreambuf_iterator
+#include <fstream>  // For reading pattern files
+#include <algorithm> // For min() and max()
+#include <cstdlib>  // For atoi()
+#include <unordered_map> // For the hash map k-mer counter
+#include <thread>   // For compressing blocks in parallel
+#include <atomic>
+#include <functional>
+#include <cstdio>   // For rename() and remove() of temporary files
+#include <cctype>   // For isalnum()
+#include <cerrno>   // For the range check of strtoull()
 #define DEBUG 0
 
+// The SIMD kernels are only built for x86 with GCC or Clang. Every other
+// target, and x86 CPUs without AVX2, use the scalar loops.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+// Alphabets smaller than this are counted into four interleaved tables.
+#define HISTOGRAM_TABLES_LIMIT 65536
+
 using namespace std;
 
+// Enhanced suffix array: SA plus LCP plus the child table of Abouelhoda,
+// Kurtz and Ohlebusch. LCP has size n+1 with LCP[0] = LCP[n] = -1 so that
+// the whole SA is the root lcp-interval [0..n-1].
+struct ESA{
+  vector<int> SA;
+  vector<int> LCP;
+  vector<int> child;
+};
+
+// Compressed suffix array. Psi[i] = ISA[SA[i]+1] is increasing inside each
+// first-character bucket, so it is stored as Elias-delta coded differences
+// with an absolute sample (and its bit offset) every CSA_PSI_SAMPLE_RATE
+// entries. SA is sampled at text positions divisible by CSA_SA_SAMPLE_RATE
+// (plus the $ suffix), ISA at every CSA_SA_SAMPLE_RATE-th text position.
+#define CSA_PSI_SAMPLE_RATE 64
+#define CSA_SA_SAMPLE_RATE 32
+
+struct CSA{
+  int size;                              // n + 1, the $ suffix included
+  vector<int> C;                         // C[c] = first SA index starting with c
+  vector<unsigned long long> psi_bits;   // delta coded Psi
+  long long psi_bit_count;
+  vector<int> psi_samples;               // Psi[k * CSA_PSI_SAMPLE_RATE]
+  vector<long long> psi_pointers;        // bit offset after each sample
+  vector<unsigned long long> sa_marked;  // 1 where SA[i] is sampled
+  vector<int> sa_marked_rank;            // marked bits before each word
+  vector<int> sa_samples;                // sampled SA values in SA order
+  vector<int> isa_samples;               // ISA[k * CSA_SA_SAMPLE_RATE]
+};
+
+// An lcp-interval [lb..rb] whose suffixes share a prefix of length lcp.
+struct lcp_interval{
+  int lcp;
+  int lb;
+  int rb;
+};
+
+// DNA text packed at 2 bits per base, 32 bases per 64-bit word with the first
+// base in the high bits. operator[] gives the names assign_index_to_T would
+// give (dense, in ACGT order, starting from 1) and 0 for the $ after the last
+// base, so the SAIS steps read it exactly like a T_array.
+class Packed_DNA_text{
+  public:
+    Packed_DNA_text();
+    int append(string &bases);
+    void finish();
+    int operator[](int i) const;
+    size_t size() const;
+    unsigned long long get_word(int i) const;
+    char get_base(int i) const;
+
+  private:
+    vector<unsigned long long> words;
+    int number_of_bases;
+    int names[4]; // Name of each base code, after finish()
+};
+
+// Block-sorting compressor. Symbols after move-to-front and zero run coding:
+// RUNA and RUNB spell the length of a run of zeros, MTF rank r >= 1 is r + 1
+// and BWZ_EOB ends the block.
+#define BWZ_DEFAULT_BLOCK_SIZE 900000
+#define BWZ_MAX_BLOCK_SIZE (1 << 30)
+#define BWZ_RUNA 0
+#define BWZ_RUNB 1
+#define BWZ_EOB 257
+#define BWZ_SYMBOL_BITS 9
+#define RANGE_PROBABILITY_BITS 11
+#define RANGE_ADAPT_SHIFT 5
+
+// One compressed block and the header fields stored in front of it.
+struct Compressed_block{
+  int raw_length;
+  unsigned int crc;
+  int primary;         // BWT row of the whole block (where the $ was)
+  int payload_length;
+  string payload;
+};
+
+class Range_encoder{
+  public:
+    Range_encoder(string &output);
+    void encode_bit(unsigned short &probability, int bit);
+    void encode_symbol(vector<unsigned short> &tree, int symbol);
+    void flush();
+
+  private:
+    void shift_low();
+    string &output;
+    unsigned long long low;
+    unsigned int range;
+    unsigned char cache;
+    long long cache_size;
+};
+
+class Range_decoder{
+  public:
+    Range_decoder(string &stream, size_t offset, size_t end);
+    int decode_bit(unsigned short &probability);
+    int decode_symbol(vector<unsigned short> &tree);
+
+  private:
+    unsigned int next_byte();
+    string &stream;
+    size_t position;
+    size_t end;
+    unsigned int range;
+    unsigned int code;
+};
+
+// Index of a document collection (one document per input line). text holds
+// the documents, each followed by a '\n' as its terminator. SA and BWT have a
+// row for the final $ too. The row of suffix 0 has a '\n' in the BWT, as if a
+// terminator came before the first document (only characters are ranked). C and
+// the occurrence checkpoints are rebuilt on load. An index built by -bcr-build
+// has only the BWT (text and SA empty): it can be searched but not merged.
+#define FM_OCC_SAMPLE_RATE 256
+
+struct FM_index{
+  int document_count;
+  vector<char> text;
+  vector<int> SA;
+  vector<char> BWT;
+  vector<int> C;           // C[c] = rows before the first suffix starting with c
+  vector<int> occ_samples; // count of each byte in BWT before every sample row
+};
+
+// Column-wise (BCR) construction of the BWT of a string collection. The
+// input is read again for every group of BCR_COLUMNS_PER_PASS columns.
+#define BCR_COLUMNS_PER_PASS 128
+#define BCR_BUFFER_SIZE (1 << 16)
+
+// Bitvector with a rank directory: the number of ones before every block of
+// RANK_BLOCK_WORDS 64-bit words. rank is a lookup plus a few popcounts,
+// select a binary search over the blocks plus popcounts.
+#define RANK_BLOCK_WORDS 8
+
+struct Rank_bitvector{
+  vector<unsigned long long> bits;
+  vector<int> block_ranks;
+  int ones;
+};
+
+// Wavelet matrix (Claude, Navarro and Ordonez): one bitvector per bit of
+// the symbols, highest bit first, each level stably partitioned by its bit.
+struct Wavelet_matrix{
+  int size;
+  int levels;
+  vector<Rank_bitvector> bitvectors;
+  vector<int> zeros;   // number of zeros on each level
+};
+
+// Bidirectional index: wavelet matrices over the BWTs of T and reverse(T),
+// the SA of T for locating, and C (the same for both).
+struct Bidirectional_index{
+  Wavelet_matrix forward;
+  Wavelet_matrix reverse;
+  vector<int> SA;
+  vector<int> C;
+  int name[256]; // The symbol of every byte, 0 if it is not in T
+  int sigma;     // Symbols, with the $
+};
+
+// The rows of a string in the SA of T and of its reverse in the SA of
+// reverse(T). Both ranges have the same size.
+struct Bi_interval{
+  int forward;
+  int reverse;
+  int size;
+};
+
+// One search of a search scheme: the order the parts are matched in and
+// the bounds on the errors after each of them.
+struct Search{
+  vector<int> order;
+  vector<int> L;
+  vector<int> U;
+};
+
+// State of one approximate pattern search.
+struct Approx_search{
+  Bidirectional_index *index;
+  string pattern;
+  bool edit;
+  vector<int> part_start;  // parts + 1 entries
+  vector<Search> searches;
+  int current;             // the search being run
+  vector<int> positions;
+};
+
+// Longest common extension: LCE(i, j) = min LCP[ISA[i]+1..ISA[j]] (ranks in
+// order), with a sparse table over the minima of blocks of LCE_BLOCK_SIZE.
+#define LCE_BLOCK_SIZE 32
+#define LCE_PREFETCH_DISTANCE 8
+
+struct LCE_index{
+  int text_size;
+  vector<int> ISA;
+  vector<int> LCP;
+  int blocks;
+  int levels;
+  vector<int> sparse;   // levels rows of blocks entries
+};
+
+// Maximal exact matches between A and B. Every open lcp-interval keeps the
+// SA rows below it in lists by side (A or B) and the character before the
+// suffix (MEM_NO_LEFT at the start of A or B). The lists are linked through
+// one next_row array, so joining two of them is O(1).
+#define MEM_NO_LEFT 256
+
+struct Position_list{
+  int side;
+  int left;
+  int head;
+  int tail;
+};
+
+struct MEM_interval{
+  int lcp;
+  vector<Position_list> lists;
+};
+
+struct MEM_search{
+  vector<int> SA;
+  int size_of_A;
+  int min_length;
+  long long mem_count;
+  ostringstream output;
+  ostream *sink; // Where output goes every 1 MB
+};
+
+// Prefix-free parsing. A window of W characters whose Karp-Rabin hash is 0
+// modulo P is a trigger; the text is cut into phrases that start and end at
+// triggers (and overlap by W). The BWT is put together from the sorted
+// dictionary of distinct phrases and the suffix array of the parse.
+#define PFP_DEFAULT_WINDOW 10
+#define PFP_DEFAULT_MODULUS 100
+#define PFP_HASH_BASE 257ULL
+#define PFP_HASH_PRIME 1999999973ULL
+#define PFP_MIN_CHUNK 65536
+
+struct PFP_parse{
+  int window;
+  vector<string> phrases;  // Distinct phrases, the last one is followed by W $
+  int last_phrase;
+  vector<int> parse;       // Phrase ids in text order
+};
+
 // Prototyping:
 void assign_index_to_T(vector<int> &T_array, string inputted_string, int size_of_string);
-int get_number_of_occurences(vector<int> &T_array, vector<int> &number_of_occurences);
+// The SAIS steps are templates over the text type Text, which is either
+// vector<int> or Packed_DNA_text (anything with operator[] and size()).
+// The recursion always works on a vector<int> T1.
+template <typename Text>
+int get_number_of_occurences(Text &T_array, vector<int> &number_of_occurences);
 void get_head_tail_indexes(vector<int> &number_of_occurences, vector<int> &bucket_head,
   vector<int> &bucket_tail);
-void calculate_S_type(vector<int>&T_array, vector<int>&SA_array,
+template <typename Text>
+void calculate_S_type(Text &T_array, vector<int>&SA_array,
   vector<int>&S_type_array, vector<int>&bucket_head, vector<int>&bucket_tail);
-void induce_sort(vector<int>&T_array, vector<int>&SA_array, vector<int>&S_type_array,
+int cpu_has_avx2();
+int find_max_symbol(vector<int> &T_array);
+template <typename Text>
+int find_max_symbol(Text &T_array);
+void classify_suffix_types(vector<int> &T_array, vector<int> &S_type_array);
+template <typename Text>
+void classify_suffix_types(Text &T_array, vector<int> &S_type_array);
+template <typename Text>
+void classify_types_scalar(Text &T_array, vector<int> &S_type_array, int high,
+  int low);
+#if HAVE_X86_SIMD
+int find_max_symbol_avx2(const int *T, int size_of_T);
+void classify_blocks_avx2(const int *T, int *S_type, int blocks);
+#endif
+template <typename Text>
+void induce_sort(Text &T_array, vector<int>&SA_array, vector<int>&S_type_array,
   vector<int>&L_type_array, vector<int>&bucket_head, vector<int>&bucket_tail,
   vector<int>&number_of_occurences);
 void print_SA_array(vector<int> &SA_array);
-void calculate_T1_array(vector<int>&T_array, vector<int>&SA_array, vector<int>&S_type_array,
+template <typename Text>
+void calculate_T1_array(Text &T_array, vector<int>&SA_array, vector<int>&S_type_array,
   vector<int>&T1_array, vector<int>&X_array, vector<int>&L_type_array);
-int compare_lms_substrings(vector<int> &S_type_array, vector<int> &T_array,
+template <typename Text>
+int compare_lms_substrings(vector<int> &S_type_array, Text &T_array,
   int previous, int p);
-void run_SAIS(vector<int> &SA_array, vector<int> &T_array_param, int size_of_string,
+int compare_lms_substrings(vector<int> &S_type_array, Packed_DNA_text &T_array,
+  int previous, int p);
+template <typename Text>
+void run_SAIS(vector<int> &SA_array, Text &T_array_param, int size_of_string,
   int &recursion_counter);
 void print_BWT(vector<int> &SA_array, string substring);
+void print_BWT(vector<int> &SA_array, Packed_DNA_text &text);
+int run_dna_mode();
+void compute_PSV_NSV(vector<int> &SA_array, vector<int> &PSV_array, vector<int> &NSV_array);
+int naive_lcp(string &text, int i, int j);
+void lz77_factorize(vector<int> &SA_array, string &text, vector<int> &factor_pos,
+  vector<int> &factor_len);
+void append_varint(string &stream, unsigned long long value);
+int read_varint(string &stream, size_t &offset, unsigned long long &value);
+void write_lz77_stream(string &text, vector<int> &factor_pos, vector<int> &factor_len);
+int run_lz77_mode(vector<int> &SA_array, string &inputted_string, bool benchmark,
+  double sais_seconds);
+int run_lz77_decode();
+double seconds_since(chrono::steady_clock::time_point start);
+template <typename Text>
+void compute_LCP_array(vector<int> &SA_array, Text &text, vector<int> &LCP_array);
+void build_ESA(vector<int> &SA_array, string &text, ESA &esa);
+int get_first_l_index(ESA &esa, int i, int j);
+int get_child_interval(ESA &esa, string &text, int i, int j, int lcp, char c,
+  int &child_lb, int &child_rb);
+int esa_find(ESA &esa, string &text, string &pattern, int &lb, int &rb);
+void esa_bottom_up_intervals(ESA &esa, vector<lcp_interval> &intervals);
+int sa_binary_search_count(vector<int> &SA_array, string &text, string &pattern);
+int read_lines(string file_name, vector<string> &lines);
+int run_esa_mode(vector<int> &SA_array, string &inputted_string, string mode,
+  string pattern_file);
+int mode_argument_count(string mode);
+void bits_append(vector<unsigned long long> &bits, long long &bit_count,
+  unsigned long long value, int length);
+unsigned long long bits_read(vector<unsigned long long> &bits, long long position,
+  int length);
+void elias_delta_append(vector<unsigned long long> &bits, long long &bit_count,
+  unsigned long long value);
+unsigned long long elias_delta_read(vector<unsigned long long> &bits, long long &position);
+void build_CSA(vector<int> &SA_array, string &text, CSA &csa);
+int csa_psi(CSA &csa, int i);
+int csa_first_char(CSA &csa, int i);
+int csa_sa_marked(CSA &csa, int i);
+int csa_lookup_SA(CSA &csa, int i);
+int csa_lookup_ISA(CSA &csa, int p);
+int csa_count(CSA &csa, string &pattern);
+long long csa_size_in_bits(CSA &csa);
+int save_CSA(CSA &csa, string file_name);
+int load_CSA(CSA &csa, string file_name);
+int run_csa_mode(vector<int> &SA_array, string &inputted_string, string mode,
+  string csa_file);
+int run_csa_query(string csa_file, string query_file);
+int csa_compare_suffix(CSA &csa, int i, string &pattern);
+template <typename V>
+void write_array(ofstream &file, vector<V> &array);
+template <typename V>
+int read_array(ifstream &file, vector<V> &array);
+int parse_k_list(string k_list, vector<int> &k_values);
+void count_kmers(vector<int> &SA_array, vector<int> &LCP_array, string &text,
+  vector<int> &k_values, int min_count, string *output, long long &distinct);
+long long count_kmers_hash_map(string &text, vector<int> &k_values, int min_count);
+int run_kmer_mode(vector<int> &SA_array, string &inputted_string, string k_list,
+  int min_count, bool benchmark, double sais_seconds);
+unsigned int crc32(const char *data, size_t len);
+vector<unsigned int> make_crc32_table();
+void append_u32(string &stream, unsigned int value);
+int read_u32(string &stream, size_t &offset, unsigned int &value);
+void compress_block(string &block, Compressed_block &result);
+void encode_zero_run(Range_encoder &encoder, vector<unsigned short> &tree, int run);
+int decompress_block(string &stream, size_t offset, Compressed_block &info, string &block);
+void run_block_workers(int block_count, int thread_count, function<void(int)> job);
+void bwz_compress(string &data, int block_size, int thread_count, string &output);
+int bwz_decompress(string &stream, int thread_count, string &output);
+int run_compress_mode(string mode, int argc, char *argv[]);
+int read_documents(istream &input, vector<char> &text);
+void build_FM_index(vector<char> &text, int document_count, FM_index &index);
+void prepare_FM_index(FM_index &index);
+int fm_occ(FM_index &index, unsigned char c, int row);
+void write_FM_index_header(ofstream &file, int document_count);
+int save_FM_index(FM_index &index, string file_name);
+int load_FM_index(FM_index &index, string file_name);
+void merge_FM_index(FM_index &A, FM_index &B, FM_index &merged);
+int run_fm_mode(string mode, int argc, char *argv[]);
+int fm_count(FM_index &index, string &pattern, int &lb, int &rb);
+string bcr_file_name(string out_file, string kind, int k);
+void bcr_remove_files(string out_file, int first_column, int last_column);
+void bcr_copy_bytes(streambuf *in, streambuf *out, long long count, long long *counts);
+void bcr_write_columns(string out_file, int first, int last);
+void bcr_load_column(string out_file, vector<int> &lengths, int max_length, int k,
+  vector<char> &column);
+int build_BCR(istream &input, string out_file);
+void build_rank_bitvector(Rank_bitvector &bv);
+int bv_rank1(Rank_bitvector &bv, int i);
+int bv_select(Rank_bitvector &bv, int bit, int k);
+void build_wavelet_matrix(vector<int> &sequence, int sigma, Wavelet_matrix &wm);
+int wm_access(Wavelet_matrix &wm, int i);
+int wm_rank(Wavelet_matrix &wm, int c, int i);
+int wm_select(Wavelet_matrix &wm, int c, int k);
+long long wm_size_in_bits(Wavelet_matrix &wm);
+int wm_backward_search(Wavelet_matrix &wm, vector<int> &C, vector<int> &pattern,
+  int &lb, int &rb);
+void bwt_symbols_and_C(vector<int> &SA_array, vector<int> &T_array, int sigma,
+  vector<int> &BWT, vector<int> &C);
+bool parse_token(string &word, unsigned long long &value);
+int run_tokens_mode(string pattern_file);
+int run_wm_bench(vector<int> &SA_array, string &inputted_string, string pattern_file);
+void wm_range_count(Wavelet_matrix &wm, int c, int i, int j, int &rank, int &count,
+  int &less);
+void wm_distinct_symbols(Wavelet_matrix &wm, int level, int i, int j, int prefix,
+  vector<int> &symbols);
+void build_bidirectional_index(string &text, Bidirectional_index &index);
+int bi_extend(Bidirectional_index &index, Bi_interval &in, int c, int direction,
+  Bi_interval &out);
+void get_search_scheme(int k, int &parts, vector<Search> &searches);
+void approx_step(Approx_search &search, int t, int lo, int hi, Bi_interval interval,
+  int errors);
+void approx_find(Bidirectional_index &index, string &pattern, int k, bool edit,
+  vector<int> &positions);
+int brute_force_mismatch_count(string &text, string &pattern, int k);
+int run_approx_mode(string &inputted_string, string mode, int argc, char *argv[]);
+void build_LCE(vector<int> &SA_array, string &text, LCE_index &lce);
+int lce_range_min(LCE_index &lce, int l, int r);
+int lce_query(LCE_index &lce, int i, int j);
+void lce_batch(LCE_index &lce, vector<pair<int, int> > &queries, vector<int> &answers);
+int run_lce_mode(vector<int> &SA_array, string &inputted_string, string query_file);
+int run_lce_bench(int n, int query_count);
+void mem_merge(MEM_interval &parent, MEM_interval &child, vector<int> &next_row,
+  MEM_search &context);
+void mem_report(string &A, string &B, int min_length, ostream &out);
+int run_mem_mode(string file_A, string file_B, int min_length);
+int run_mem_check();
+void pfp_find_triggers(string &text, int window, int modulus, int first, int last,
+  vector<int> &triggers);
+void pfp_parse_text(string &text, int window, int modulus, int thread_count,
+  PFP_parse &result);
+void pfp_build_BWT(string &text, PFP_parse &pfp, string &BWT);
+int run_pfp_mode(string &inputted_string, string mode, int argc, char *argv[]);
+int is_word_char(unsigned char c);
+void build_word_SA(string &text, vector<int> &word_SA);
+int run_words_mode(string mode, string pattern_file);
 
-int main(){
+/**
+ * int main
+ *
+ * Reads the text T from standard input, runs SAIS on it and prints the BWT.
+ * An optional first argument selects a different stage to run after SAIS:
+ *
+ *   -lz77        Write the LZ77 factorization of T as a binary stream.
+ *   -lz77-bench  Factorize T and report the throughput to stderr.
+ *   -unlz77      Read an LZ77 stream from stdin and print the decoded text.
+ *   -esa FILE    Count the occurrences of every line of FILE in T with a
+ *                top-down search of the enhanced suffix array.
+ *   -esa-bench FILE
+ *                Time the ESA search against binary search over SA_array.
+ *   -esa-intervals
+ *                Print every lcp-interval of T bottom-up as "lcp lb rb".
+ *   -csa-build FILE
+ *                Save the compressed suffix array of T to FILE.
+ *   -csa-query CSA_FILE QUERY_FILE
+ *                Answer "sa i", "isa p" and "count P" lines of QUERY_FILE
+ *                from a saved compressed suffix array. Reads no text.
+ *   -csa-bench   Compare space and access time of the compressed and the
+ *                plain suffix array.
+ *   -kmer K[,K...] [MIN]
+ *                Print every distinct k-mer of T for each K with its count,
+ *                if the count is at least MIN (default 1).
+ *   -kmer-bench K[,K...]
+ *                Time the k-mer scan against counting with a hash map.
+ *   -dna         Like the default, for texts of only A, C, G and T. The text
+ *                is kept at 2 bits per base instead of an int per base.
+ *   -compress [BLOCK_SIZE] [THREADS]
+ *                Block-sorting compression of the raw bytes of stdin (BWT,
+ *                move-to-front, zero runs, range coder), blocks in parallel.
+ *   -decompress [THREADS]
+ *                Undo -compress, checking the CRC-32 of every block.
+ *   -compress-bench [BLOCK_SIZE] [THREADS]
+ *                Report ratio and compression/decompression speed.
+ *   -fm-build OUT, -fm-merge A B OUT, -fm-append A OUT, -fm-append-bench A
+ *                Index a collection with one document per line, and merge
+ *                indexes of two collections without sorting again.
+ *   -fm-count INDEX PATTERNS
+ *                Count the lines of PATTERNS in a collection index.
+ *   -bcr-build OUT
+ *                Build the BWT of a collection column by column (BCR) with
+ *                partial BWTs on disk, as an index for -fm-count.
+ *   -tokens PATTERNS
+ *                The text is whitespace separated integer tokens. Count every
+ *                line of PATTERNS (tokens) with a wavelet matrix FM index.
+ *   -wm-bench PATTERNS
+ *                Compare wavelet matrix and occurrence table backward search.
+ *   -approx K PATTERNS, -approx-edit K PATTERNS
+ *                Count the positions where every line of PATTERNS occurs
+ *                with at most K mismatches (or K edits), with search schemes
+ *                over a bidirectional index of T.
+ *   -approx-bench PATTERNS
+ *                Time those searches against a brute force scan, K = 1, 2.
+ *   -lce QUERIES Print LCE(i, j) for every "i j" line of QUERIES.
+ *   -lce-bench [N] [QUERIES]
+ *                Time LCE queries against naive comparison on random and
+ *                repetitive texts of length N. Reads no text.
+ *   -mem FILE_A FILE_B MIN
+ *                Longest common substring and all maximal exact matches of
+ *                length at least MIN between two files. Reads no stdin.
+ *   -mem-check   Run that on two generated texts whose MEMs take more than
+ *                1 MB and check the output. Reads no stdin.
+ *   -pfp [W] [P] [THREADS]
+ *                Like the default, but the BWT is built by prefix-free
+ *                parsing (window W, modulus P), for repetitive texts.
+ *   -pfp-bench [W] [P] [THREADS]
+ *                Time prefix-free parsing against SAIS on the whole text.
+ *   -words PATTERNS
+ *                Sort only the suffixes that start a word of stdin (raw
+ *                bytes) and count the words that start with every line of
+ *                PATTERNS.
+ *   -words-bench PATTERNS
+ *                Compare that against the full suffix array filtered.
+ *
+ * @return -1 Returns an error (unknown mode or bad input).
+ * @return 0 Program executed with no problem.
+ */
+int main(int argc, char *argv[]){
   string inputted_string;
   int size_of_string;
   int recursion_counter = 0;
+  string mode = "";
+
+  if(argc > 1){
+    mode = argv[1];
+  }
+
+  // The decoder does not need a suffix array, it only reads the stream.
+  if(mode == "-unlz77"){
+    return run_lz77_decode();
+  }
+
+  // DNA mode packs the text while reading it, it never builds T_array.
+  if(mode == "-dna"){
+    return run_dna_mode();
+  }
+
+  // The compressor reads raw bytes and sorts each block on its own.
+  if(mode == "-compress" || mode == "-decompress" || mode == "-compress-bench"){
+    return run_compress_mode(mode, argc, argv);
+  }
+
+  // The collection modes keep the lines as separate documents.
+  if(mode == "-fm-build" || mode == "-fm-merge" || mode == "-fm-append" ||
+    mode == "-fm-append-bench" || mode == "-fm-count" || mode == "-bcr-build"){
+    return run_fm_mode(mode, argc, argv);
+  }
+
+  // Two input files instead of stdin.
+  if(mode == "-mem"){
+    if(argc < 5){
+      cerr << "ERROR: -mem needs 3 argument(s)." << endl;
+      return -1;
+    }
+    return run_mem_mode(argv[2], argv[3], atoi(argv[4]));
+  }
+  if(mode == "-mem-check"){
+    return run_mem_check();
+  }
+
+  // The LCE benchmark makes its own texts.
+  if(mode == "-lce-bench"){
+    int n = argc > 2 ? atoi(argv[2]) : 1000000;
+    int query_count = argc > 3 ? atoi(argv[3]) : 1000000;
+    if(n < 1 || query_count < 1){
+      cerr << "ERROR: -lce-bench needs a positive length and query count." << endl;
+      return -1;
+    }
+    return run_lce_bench(n, query_count);
+  }
+
+  // Token texts are not characters, they get their own names.
+  if(mode == "-tokens"){
+    if(argc < 3){
+      cerr << "ERROR: -tokens needs 1 argument(s)." << endl;
+      return -1;
+    }
+    return run_tokens_mode(argv[2]);
+  }
+
+  // The word index keeps the newlines, they separate words.
+  if(mode == "-words" || mode == "-words-bench"){
+    if(argc < 3){
+      cerr << "ERROR: " << mode << " needs 1 argument(s)." << endl;
+      return -1;
+    }
+    return run_words_mode(mode, argv[2]);
+  }
+
+  // Modes that work on a saved compressed suffix array don't read a text.
+  if(mode == "-csa-query"){
+    if(argc < 4){
+      cerr << "ERROR: -csa-query needs a CSA file and a query file." << endl;
+      return -1;
+    }
+    return run_csa_query(argv[2], argv[3]);
+  }
+
+  int needed_arguments = mode_argument_count(mode);
+  if(needed_arguments < 0){
+    cerr << "ERROR: unknown mode <" << mode << ">." << endl;
+    return -1;
+  }
+  if(needed_arguments > 0 && argc < 2 + needed_arguments){
+    cerr << "ERROR: " << mode << " needs " << needed_arguments << " argument(s)." << endl;
+    return -1;
+  }
 
   // Read string until EOF. Use ostringstream to concatenate any ostrings
   // with a space...etc.
@@ -72,6 +667,16 @@ int main(){
     cout << "Size of inputed string is: <" << size_of_string << ">" << endl;
     cout << endl;
   }
+  // The approximate search builds both of its suffix arrays itself.
+  if(mode == "-approx" || mode == "-approx-edit" || mode == "-approx-bench"){
+    return run_approx_mode(inputted_string, mode, argc, argv);
+  }
+
+  // Prefix-free parsing only runs SAIS on the dictionary and the parse.
+  if(mode == "-pfp" || mode == "-pfp-bench"){
+    return run_pfp_mode(inputted_string, mode, argc, argv);
+  }
+
   // Allocate the T array size is of string. This will contain each char of
   // the string that we have concatenated from input or file. Don't forget
   // the dollar sign, add one to size of string.
@@ -84,7 +689,34 @@ int main(){
   assign_index_to_T(T_array, inputted_string, size_of_string);
 
   // Run the SAIS algorithm
+  chrono::steady_clock::time_point sais_start = chrono::steady_clock::now();
   run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+  double sais_seconds = seconds_since(sais_start);
+
+  if(mode == "-lz77" || mode == "-lz77-bench"){
+    return run_lz77_mode(SA_array, inputted_string, mode == "-lz77-bench", sais_seconds);
+  }
+
+  if(mode == "-esa" || mode == "-esa-bench" || mode == "-esa-intervals"){
+    return run_esa_mode(SA_array, inputted_string, mode, argc > 2 ? argv[2] : "");
+  }
+
+  if(mode == "-csa-build" || mode == "-csa-bench"){
+    return run_csa_mode(SA_array, inputted_string, mode, argc > 2 ? argv[2] : "");
+  }
+
+  if(mode == "-kmer" || mode == "-kmer-bench"){
+    return run_kmer_mode(SA_array, inputted_string, argv[2], argc > 3 ? atoi(argv[3]) : 1,
+      mode == "-kmer-bench", sais_seconds);
+  }
+
+  if(mode == "-wm-bench"){
+    return run_wm_bench(SA_array, inputted_string, argv[2]);
+  }
+
+  if(mode == "-lce"){
+    return run_lce_mode(SA_array, inputted_string, argv[2]);
+  }
 
   // Success, induction is done, now we can print the SA_array to stdout.
   //print_SA_array(SA_array);
@@ -105,7 +737,8 @@ int main(){
  * @param SA_array The address to the SA array.
  * @param T_array The address to the T array.
  */
-void run_SAIS(vector<int> &SA_array, vector<int> &T_array, int size_of_string,
+template <typename Text>
+void run_SAIS(vector<int> &SA_array, Text &T_array, int size_of_string,
   int &recursion_counter){
   int size_of_alphabet = 0;
   int tail = 0;
@@ -277,17 +910,19 @@ void assign_index_to_T(vector<int> &T_array, string inputted_string, int size_of
 
   // This is the important counter variable that will give the new name
   // to the T_array. Maintain this variable throughout assignment of T_array.
-  int counter_index = 0;
+  // Names start from 1, 0 is only for the $ (so a text with NUL bytes in
+  // it still has a unique $).
+  int counter_index = 1;
 
-  for(int i = 0; i < size_of_string; i++){
-    is_in_array[(int) inputted_string[i]] = 1;
+  for(int i = 0; i < size_of_string - 1; i++){
+    is_in_array[(unsigned char) inputted_string[i]] = 1;
   }
 
   if (DEBUG){
     cout << "Is in array is: " << endl;
-    for(int i = 0; i < size_of_string; i++){
+    for(int i = 0; i < size_of_string - 1; i++){
       cout << i << ": " << inputted_string[i] << " = ";
-      cout << is_in_array[(int) inputted_string[i]] << endl;
+      cout << is_in_array[(unsigned char) inputted_string[i]] << endl;
     }
     cout << endl;
   }
@@ -313,8 +948,8 @@ void assign_index_to_T(vector<int> &T_array, string inputted_string, int size_of
   }
 
   // Finally, map the new name to vector T_array
-  for(int i = 0; i < size_of_string; i++){
-    T_array[i] = new_name[(int) inputted_string[i]];
+  for(int i = 0; i < size_of_string - 1; i++){
+    T_array[i] = new_name[(unsigned char) inputted_string[i]];
   }
 
   if (DEBUG){
@@ -336,25 +971,41 @@ void assign_index_to_T(vector<int> &T_array, string inputted_string, int size_of
  * @param size_of_string The size of the T_array.
  * @return number_of_occurences.size() The size of the array number_of_occurences.
  */
-int get_number_of_occurences(vector<int> &T_array, vector<int> &number_of_occurences){
-  // counter
-  int temp_largest;
-  temp_largest = 0;
+template <typename Text>
+int get_number_of_occurences(Text &T_array, vector<int> &number_of_occurences){
   int size_of_T = (int) T_array.size();
   // Get the largest # occurrences; the size of all unique characters in the string.
-  for(int i = 0; i < size_of_T; i++){
-    if(temp_largest < T_array[i]){
-      temp_largest = T_array[i];
-    }
-  }
+  int temp_largest = find_max_symbol(T_array);
 
   // Resize the occurrences array to store only the unique chars.
   // Dont forget to add a spot for $.
-  number_of_occurences.resize(temp_largest + 1);
+  number_of_occurences.assign(temp_largest + 1, 0);
 
-  // Count the number of occurences and store it.
-  for(int i = 0; i < size_of_T; i++){
-    number_of_occurences[T_array[i]] = number_of_occurences[T_array[i]] + 1;
+  // Count the number of occurences and store it. With a small alphabet the
+  // same counter is hit over and over, and each increment has to wait for
+  // the store of the previous one. Four interleaved tables break that chain.
+  if(temp_largest < HISTOGRAM_TABLES_LIMIT){
+    int table_size = temp_largest + 1;
+    vector<int> tables(4 * table_size, 0);
+    int i = 0;
+    for(; i + 4 <= size_of_T; i = i + 4){
+      tables[T_array[i]] = tables[T_array[i]] + 1;
+      tables[table_size + T_array[i+1]] = tables[table_size + T_array[i+1]] + 1;
+      tables[2 * table_size + T_array[i+2]] = tables[2 * table_size + T_array[i+2]] + 1;
+      tables[3 * table_size + T_array[i+3]] = tables[3 * table_size + T_array[i+3]] + 1;
+    }
+    for(; i < size_of_T; i++){
+      tables[T_array[i]] = tables[T_array[i]] + 1;
+    }
+    for(int c = 0; c < table_size; c++){
+      number_of_occurences[c] = tables[c] + tables[table_size + c] +
+        tables[2 * table_size + c] + tables[3 * table_size + c];
+    }
+  }
+  else{
+    for(int i = 0; i < size_of_T; i++){
+      number_of_occurences[T_array[i]] = number_of_occurences[T_array[i]] + 1;
+    }
   }
 
   if (DEBUG){
@@ -422,6 +1073,250 @@ void get_head_tail_indexes(vector<int> &number_of_occurences, vector<int> &bucke
   }
 }
 
+/**
+ * int cpu_has_avx2
+ *
+ * Runtime CPU dispatch for the SIMD kernels. Asks the CPU once and
+ * remembers the answer.
+ *
+ * @return 1 Returns a 1 if the AVX2 kernels can be used.
+ * @return 0 Returns a 0 if the scalar loops must be used.
+ */
+int cpu_has_avx2(){
+#if HAVE_X86_SIMD
+  static int has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  return has_avx2;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * int find_max_symbol
+ *
+ * Returns the largest symbol in T_array, 8 symbols at a time with AVX2.
+ *
+ * @param T_array The address to the T_array.
+ * @return The largest symbol (0 for an empty array).
+ */
+int find_max_symbol(vector<int> &T_array){
+  int size_of_T = (int) T_array.size();
+#if HAVE_X86_SIMD
+  if(cpu_has_avx2()){
+    return find_max_symbol_avx2(T_array.data(), size_of_T);
+  }
+#endif
+  int temp_largest = 0;
+  for(int i = 0; i < size_of_T; i++){
+    if(temp_largest < T_array[i]){
+      temp_largest = T_array[i];
+    }
+  }
+  return temp_largest;
+}
+
+/**
+ * void classify_suffix_types
+ *
+ * Fills in the S_type_array: T[i] is S-type (1) if T[i] < T[i+1], L-type (0)
+ * if T[i] > T[i+1], and has the type of T[i+1] if they are equal. $ is
+ * S-type.
+ *
+ * The scalar scan has a branch per character that depends on the data. The
+ * AVX2 kernel instead compares 64 characters with their right neighbours,
+ * then propagates the types through runs of equal characters with bit
+ * operations, one block at a time from right to left. The part at the right
+ * end that does not fill a whole block is done with the scalar scan.
+ *
+ * @param T_array The address to the T_array.
+ * @param S_type_array The address of the S_type_array.
+ */
+void classify_suffix_types(vector<int> &T_array, vector<int> &S_type_array){
+  int size_of_T = (int) T_array.size();
+  // The last index holds the $ set that as S-type first
+  S_type_array[size_of_T - 1] = 1;
+  if(size_of_T == 1){
+    return;
+  }
+
+  // Positions 0..n-2 are classified, 64 to a block.
+  int blocks = (size_of_T - 1) / 64;
+  classify_types_scalar(T_array, S_type_array, size_of_T - 2, blocks * 64);
+
+#if HAVE_X86_SIMD
+  if(cpu_has_avx2()){
+    classify_blocks_avx2(T_array.data(), S_type_array.data(), blocks);
+    return;
+  }
+#endif
+  classify_types_scalar(T_array, S_type_array, blocks * 64 - 1, 0);
+}
+
+/**
+ * void classify_suffix_types
+ *
+ * classify_suffix_types for any other text type (the packed DNA text), with
+ * the scalar scan only.
+ *
+ * @param T_array The address to the text.
+ * @param S_type_array The address of the S_type_array.
+ */
+template <typename Text>
+void classify_suffix_types(Text &T_array, vector<int> &S_type_array){
+  int size_of_T = (int) T_array.size();
+  S_type_array[size_of_T - 1] = 1;
+  classify_types_scalar(T_array, S_type_array, size_of_T - 2, 0);
+}
+
+/**
+ * int find_max_symbol
+ *
+ * find_max_symbol for any other text type, with a scalar loop.
+ *
+ * @param T_array The address to the text.
+ * @return The largest symbol.
+ */
+template <typename Text>
+int find_max_symbol(Text &T_array){
+  int size_of_T = (int) T_array.size();
+  int temp_largest = 0;
+  for(int i = 0; i < size_of_T; i++){
+    temp_largest = max(temp_largest, T_array[i]);
+  }
+  return temp_largest;
+}
+
+/**
+ * void classify_types_scalar
+ *
+ * The scalar type scan over positions high down to low. S_type_array[high+1]
+ * must already be set.
+ *
+ * @param T_array The address to the T_array.
+ * @param S_type_array The address of the S_type_array.
+ * @param high The first (rightmost) position to classify.
+ * @param low The last (leftmost) position to classify.
+ */
+template <typename Text>
+void classify_types_scalar(Text &T_array, vector<int> &S_type_array, int high,
+  int low){
+  for(int i = high; i >= low; i--){
+    if(T_array[i+1] > T_array[i]){
+      S_type_array[i] = 1;
+    }
+    else if(T_array[i+1] < T_array[i]){
+      S_type_array[i] = 0;
+    }
+    else{
+      S_type_array[i] = S_type_array[i+1];
+    }
+  }
+}
+
+#if HAVE_X86_SIMD
+/**
+ * int find_max_symbol_avx2
+ *
+ * AVX2 kernel of find_max_symbol.
+ *
+ * @param T Pointer to the symbols.
+ * @param size_of_T The number of symbols.
+ * @return The largest symbol.
+ */
+__attribute__((target("avx2")))
+int find_max_symbol_avx2(const int *T, int size_of_T){
+  __m256i largest = _mm256_setzero_si256();
+  int i = 0;
+  for(; i + 8 <= size_of_T; i = i + 8){
+    largest = _mm256_max_epi32(largest, _mm256_loadu_si256((const __m256i *) (T + i)));
+  }
+
+  int lanes[8];
+  _mm256_storeu_si256((__m256i *) lanes, largest);
+  int temp_largest = 0;
+  for(int k = 0; k < 8; k++){
+    temp_largest = max(temp_largest, lanes[k]);
+  }
+  for(; i < size_of_T; i++){
+    temp_largest = max(temp_largest, T[i]);
+  }
+  return temp_largest;
+}
+
+/**
+ * void classify_blocks_avx2
+ *
+ * AVX2 kernel of classify_suffix_types for the blocks [64b, 64b+64), b from
+ * blocks-1 down to 0. For each block:
+ *
+ *   1. Compare T[i] with T[i+1] 8 at a time into two 64-bit masks, lt (the
+ *      position is S-type) and gt (the position is L-type).
+ *   2. A position with neither bit takes the type of its right neighbour.
+ *      This is a carry running from high bits to low bits through the equal
+ *      positions, so it is resolved with a log-step (Kogge-Stone) scan.
+ *   3. The run of equal positions at the top of the block takes the type of
+ *      the first position of the block to its right.
+ *   4. Expand the 64 type bits back to ints.
+ *
+ * @param T Pointer to the T_array.
+ * @param S_type Pointer to the S_type_array, set at position 64 * blocks.
+ * @param blocks The number of blocks to classify.
+ */
+__attribute__((target("avx2")))
+void classify_blocks_avx2(const int *T, int *S_type, int blocks){
+  const __m256i bit_select = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  int carry = S_type[blocks * 64];
+
+  for(int b = blocks - 1; b >= 0; b--){
+    int base = b * 64;
+    unsigned long long lt = 0;
+    unsigned long long gt = 0;
+
+    for(int k = 0; k < 8; k++){
+      __m256i current = _mm256_loadu_si256((const __m256i *) (T + base + 8 * k));
+      __m256i next = _mm256_loadu_si256((const __m256i *) (T + base + 8 * k + 1));
+      unsigned long long lt_bits = (unsigned int) _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(next, current)));
+      unsigned long long gt_bits = (unsigned int) _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(current, next)));
+      lt = lt | (lt_bits << (8 * k));
+      gt = gt | (gt_bits << (8 * k));
+    }
+
+    unsigned long long decided = lt | gt;
+    unsigned long long equal = ~decided;
+    unsigned long long types = lt;
+    types = types | (equal & (types >> 1));
+    equal = equal & (equal >> 1);
+    types = types | (equal & (types >> 2));
+    equal = equal & (equal >> 2);
+    types = types | (equal & (types >> 4));
+    equal = equal & (equal >> 4);
+    types = types | (equal & (types >> 8));
+    equal = equal & (equal >> 8);
+    types = types | (equal & (types >> 16));
+    equal = equal & (equal >> 16);
+    types = types | (equal & (types >> 32));
+
+    if(carry){
+      unsigned long long top_run = ~0ULL;
+      if(decided != 0){
+        int highest = 63 - __builtin_clzll(decided);
+        top_run = (highest == 63) ? 0 : (~0ULL << (highest + 1));
+      }
+      types = types | top_run;
+    }
+    carry = (int) (types & 1);
+
+    for(int k = 0; k < 8; k++){
+      __m256i bits = _mm256_set1_epi32((int) ((types >> (8 * k)) & 0xff));
+      __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(bits, bit_select), bit_select);
+      _mm256_storeu_si256((__m256i *) (S_type + base + 8 * k), _mm256_srli_epi32(set, 31));
+    }
+  }
+}
+#endif
+
 /**
  * void calculate_S_type
  *
@@ -432,43 +1327,31 @@ void get_head_tail_indexes(vector<int> &number_of_occurences, vector<int> &bucke
  * Composition added (4/23/18): map S-type to SA_array while looking for
  * and setting S-type. Much more efficient this way.
  *
+ * The types are now computed first by classify_suffix_types (block-wise
+ * with SIMD when available), then one right to left scan maps the LMS
+ * positions to SA_array in the same order as before.
+ *
  * @param T_array The address to the T_array.
  * @param SA_array The address to the SA_array.
  * @param S_type_array The address of the S_type_array.
  * @param bucket_head The address to the bucket_head array.
  * @param bucket_tail The address to the bucket_tail array.
  */
-void calculate_S_type(vector<int>& T_array, vector<int>& SA_array,
+template <typename Text>
+void calculate_S_type(Text &T_array, vector<int>& SA_array,
   vector<int> &S_type_array, vector<int> &bucket_head, vector<int>& bucket_tail){
-  int S_type_size = (int) S_type_array.size();
-  // The last index holds the $ set that as S-type first
-  S_type_array[(S_type_size -1)] = 1;
-
-  // The very next one to the left should be L-type since $ is the smallest.
-  S_type_array[(int) S_type_array.size()-2] = 0;
+  // Types first, in blocks when the CPU allows it.
+  classify_suffix_types(T_array, S_type_array);
 
   // Scan the T array from right to left
   for(int i = T_array.size() - 2; i >= 0; i--){
-    // Check to see if right of current is bigger than or equal to current
-    if (T_array[i+1] >= T_array[i]){
-      // This means current is less so it's a S type
-      if(T_array[i+1] > T_array[i]){
-        S_type_array[i] = 1;
-      }
-      if(T_array[i+1] == T_array[i]){
-        S_type_array[i] = S_type_array[i+1];
-      }
-
-    }
-    else{
-      // Current is L-type, check if right of current is of S-type...
-      // If yes, then we found LMS starting. Map the LMS to SA_array. Append
-      // at the end of the bucket for found char that is of LMS type.
-      if (S_type_array[i+1] == 1){
-        SA_array[bucket_tail[T_array[i+1]]] = (i+1);
-        // Move the tail to left one.
-        bucket_tail[T_array[i+1]] = bucket_tail[T_array[i+1]] - 1;
-      }
+    // Current is L-type, check if right of current is of S-type...
+    // If yes, then we found LMS starting. Map the LMS to SA_array. Append
+    // at the end of the bucket for found char that is of LMS type.
+    if(S_type_array[i] == 0 && S_type_array[i+1] == 1){
+      SA_array[bucket_tail[T_array[i+1]]] = (i+1);
+      // Move the tail to left one.
+      bucket_tail[T_array[i+1]] = bucket_tail[T_array[i+1]] - 1;
     }
   }
 
@@ -524,7 +1407,8 @@ void calculate_S_type(vector<int>& T_array, vector<int>& SA_array,
  * @param bucket_head Address to the bucket_head array.
  * @param bucket_tail Address to the bucket_tail_array.
  */
-void induce_sort(vector<int>&T_array, vector<int>&SA_array, vector<int>&S_type_array,
+template <typename Text>
+void induce_sort(Text &T_array, vector<int>&SA_array, vector<int>&S_type_array,
   vector<int>&L_type_array, vector<int>&bucket_head, vector<int>&bucket_tail,
   vector<int>&number_of_occurences){
   int SA_size = (int) SA_array.size();
@@ -671,7 +1555,8 @@ void print_SA_array(vector<int> &SA_array){
  * @param T1_array The address to the T1 array.
  * @param X_array The address to the X array
  */
-void calculate_T1_array(vector<int>&T_array, vector<int>&SA_array, vector<int>&S_type_array,
+template <typename Text>
+void calculate_T1_array(Text &T_array, vector<int>&SA_array, vector<int>&S_type_array,
   vector<int>&T1_array, vector<int>&X_array, vector<int>&L_type_array){
   // Need to maintain an array N (names of LMS substrings) of the same size as T)
   vector<int> N_array(T_array.size(), -1);
@@ -753,7 +1638,8 @@ void calculate_T1_array(vector<int>&T_array, vector<int>&SA_array, vector<int>&S
  * @return 1 Returns a 1 if the LMS substrings are identical.
  * @return 0 Returns a 0 if the LMS substrings are not identical.
  */
-int compare_lms_substrings(vector<int> &S_type_array, vector<int> &T_array, int previous, int p){
+template <typename Text>
+int compare_lms_substrings(vector<int> &S_type_array, Text &T_array, int previous, int p){
   bool started  = true;
   while(1){
     if((T_array[p] != T_array[previous]) || (S_type_array[previous] != S_type_array[p])){
@@ -799,3 +1685,5229 @@ void print_BWT(vector<int> &SA_array, string substring){
   }
   cout << endl;
 }
+
+/**
+ * double seconds_since
+ *
+ * Helper for the benchmark modes. Returns the wall clock time that has passed
+ * since start, in seconds.
+ *
+ * @param start The time point the measurement started at.
+ * @return The elapsed time in seconds.
+ */
+double seconds_since(chrono::steady_clock::time_point start){
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+/**
+ * void compute_PSV_NSV
+ *
+ * For every text position p, finds the previous smaller value (PSV) and the
+ * next smaller value (NSV) of p in the SA_array. These are the positions
+ * left of p whose suffixes are lexicographically closest to the suffix at p,
+ * one from below and one from above, so the longest previous match for p is
+ * always at one of them (KKP-style LZ77). Both are computed in one left to
+ * right scan of the SA_array with a stack. -1 means there is no such value.
+ *
+ * @param SA_array The address to the SA array.
+ * @param PSV_array The address to the PSV array (indexed by text position).
+ * @param NSV_array The address to the NSV array (indexed by text position).
+ */
+void compute_PSV_NSV(vector<int> &SA_array, vector<int> &PSV_array, vector<int> &NSV_array){
+  int SA_size = (int) SA_array.size();
+  vector<int> stack_array;
+  stack_array.reserve(SA_size);
+
+  PSV_array.assign(SA_size, -1);
+  NSV_array.assign(SA_size, -1);
+
+  for(int i = 0; i < SA_size; i++){
+    int p = SA_array[i];
+    // Everything on the stack bigger than p has found its next smaller value.
+    while(!stack_array.empty() && stack_array.back() > p){
+      NSV_array[stack_array.back()] = p;
+      stack_array.pop_back();
+    }
+    if(!stack_array.empty()){
+      PSV_array[p] = stack_array.back();
+    }
+    stack_array.push_back(p);
+  }
+}
+
+/**
+ * int naive_lcp
+ *
+ * Compares the suffixes of text at i and j character by character and
+ * returns the length of their longest common prefix.
+ *
+ * @param text The address to the text.
+ * @param i The starting position of the first suffix.
+ * @param j The starting position of the second suffix.
+ * @return length The length of the longest common prefix.
+ */
+int naive_lcp(string &text, int i, int j){
+  int text_size = (int) text.size();
+  int length = 0;
+  while(i + length < text_size && j + length < text_size &&
+    text[i + length] == text[j + length]){
+    length++;
+  }
+  return length;
+}
+
+/**
+ * void lz77_factorize
+ *
+ * Computes the LZ77 factorization of the text from its suffix array in
+ * linear time. Starting at position i = 0, the factor at i is the longest
+ * previous match found at PSV[i] or NSV[i]. If neither matches even one
+ * character the factor is a literal. Each lcp computed is bounded by the
+ * length of the factor, so all the naive comparisons add up to O(n).
+ *
+ * A factor is stored as (factor_pos, factor_len). A literal has length 0 and
+ * stores its character in factor_pos.
+ *
+ * @param SA_array The address to the SA array (with the $ suffix).
+ * @param text The address to the text (without $).
+ * @param factor_pos The address to the array of source positions.
+ * @param factor_len The address to the array of factor lengths.
+ */
+void lz77_factorize(vector<int> &SA_array, string &text, vector<int> &factor_pos,
+  vector<int> &factor_len){
+  vector<int> PSV_array;
+  vector<int> NSV_array;
+  int text_size = (int) text.size();
+  int i = 0;
+
+  compute_PSV_NSV(SA_array, PSV_array, NSV_array);
+
+  while(i < text_size){
+    int psv_len = 0;
+    int nsv_len = 0;
+    if(PSV_array[i] >= 0){
+      psv_len = naive_lcp(text, i, PSV_array[i]);
+    }
+    if(NSV_array[i] >= 0){
+      nsv_len = naive_lcp(text, i, NSV_array[i]);
+    }
+
+    if(psv_len == 0 && nsv_len == 0){
+      // No previous occurrence of this character, emit a literal.
+      factor_pos.push_back((unsigned char) text[i]);
+      factor_len.push_back(0);
+      i = i + 1;
+    }
+    else if(psv_len >= nsv_len){
+      factor_pos.push_back(PSV_array[i]);
+      factor_len.push_back(psv_len);
+      i = i + psv_len;
+    }
+    else{
+      factor_pos.push_back(NSV_array[i]);
+      factor_len.push_back(nsv_len);
+      i = i + nsv_len;
+    }
+  }
+
+  if(DEBUG){
+    cout << "LZ77 factors (pos, len):" << endl;
+    for(int f = 0; f < (int) factor_len.size(); f++){
+      cout << "(" << factor_pos[f] << ", " << factor_len[f] << ") ";
+    }
+    cout << endl;
+    cout << endl;
+  }
+}
+
+/**
+ * void append_varint
+ *
+ * Appends value to the stream in the LEB128 variable length format, 7 bits
+ * per byte with the high bit set on every byte except the last one.
+ *
+ * @param stream The address to the output byte stream.
+ * @param value The value to append.
+ */
+void append_varint(string &stream, unsigned long long value){
+  while(value >= 0x80){
+    stream.push_back((char) ((value & 0x7f) | 0x80));
+    value = value >> 7;
+  }
+  stream.push_back((char) value);
+}
+
+/**
+ * int read_varint
+ *
+ * Reads one LEB128 value from the stream starting at offset and moves the
+ * offset past it.
+ *
+ * @param stream The address to the input byte stream.
+ * @param offset The address to the current offset in the stream.
+ * @param value The address to store the value read.
+ * @return 1 Returns a 1 if a value was read.
+ * @return 0 Returns a 0 if the stream ended in the middle of the value.
+ */
+int read_varint(string &stream, size_t &offset, unsigned long long &value){
+  int shift = 0;
+  value = 0;
+  while(offset < stream.size() && shift < 64){
+    unsigned char byte = (unsigned char) stream[offset];
+    offset++;
+    value = value | ((unsigned long long) (byte & 0x7f) << shift);
+    if((byte & 0x80) == 0){
+      return 1;
+    }
+    shift = shift + 7;
+  }
+  return 0;
+}
+
+/**
+ * void write_lz77_stream
+ *
+ * Writes the factorization to stdout as a compact binary stream:
+ *
+ *   "LZ77" <varint text length> then for every factor
+ *   <varint length> <literal byte>            if length is 0
+ *   <varint length> <varint distance>         otherwise
+ *
+ * The distance is i - source position, which is small for most factors.
+ *
+ * @param text The address to the text.
+ * @param factor_pos The address to the array of source positions.
+ * @param factor_len The address to the array of factor lengths.
+ */
+void write_lz77_stream(string &text, vector<int> &factor_pos, vector<int> &factor_len){
+  string stream = "LZ77";
+  int i = 0;
+
+  append_varint(stream, text.size());
+  for(int f = 0; f < (int) factor_len.size(); f++){
+    append_varint(stream, factor_len[f]);
+    if(factor_len[f] == 0){
+      stream.push_back((char) factor_pos[f]);
+      i = i + 1;
+    }
+    else{
+      append_varint(stream, i - factor_pos[f]);
+      i = i + factor_len[f];
+    }
+  }
+  cout.write(stream.data(), stream.size());
+  cout.flush();
+}
+
+/**
+ * int run_lz77_mode
+ *
+ * Runs the LZ77 stage on the suffix array of the inputted string. Either
+ * writes the binary factor stream to stdout, or, for the benchmark, reports
+ * the number of factors and the throughput of SAIS and of the factorization
+ * to stderr.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param benchmark True to only report timings.
+ * @param sais_seconds Time spent in run_SAIS.
+ * @return 0 Factorization finished.
+ */
+int run_lz77_mode(vector<int> &SA_array, string &inputted_string, bool benchmark,
+  double sais_seconds){
+  vector<int> factor_pos;
+  vector<int> factor_len;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  lz77_factorize(SA_array, inputted_string, factor_pos, factor_len);
+  double lz77_seconds = seconds_since(start);
+
+  if(!benchmark){
+    write_lz77_stream(inputted_string, factor_pos, factor_len);
+    return 0;
+  }
+
+  double megabytes = inputted_string.size() / 1000000.0;
+  cerr << "LZ77: " << inputted_string.size() << " bytes, " << factor_len.size()
+    << " factors" << endl;
+  cerr << "  SAIS:      " << sais_seconds << " s (" << megabytes / sais_seconds
+    << " MB/s)" << endl;
+  cerr << "  factorize: " << lz77_seconds << " s (" << megabytes / lz77_seconds
+    << " MB/s)" << endl;
+  return 0;
+}
+
+/**
+ * int run_lz77_decode
+ *
+ * Reads a stream written by write_lz77_stream from stdin and prints the
+ * decoded text. Copies are done one character at a time so that overlapping
+ * factors (distance smaller than length) decode correctly.
+ *
+ * @return -1 Returns an error if the stream is malformed.
+ * @return 0 Decoding finished.
+ */
+int run_lz77_decode(){
+  string stream((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+  string text;
+  size_t offset = 4;
+  unsigned long long text_size, length, distance;
+
+  if(stream.compare(0, 4, "LZ77") != 0 || !read_varint(stream, offset, text_size)){
+    cerr << "ERROR: not an LZ77 stream." << endl;
+    return -1;
+  }
+
+  text.reserve(text_size);
+  while(text.size() < text_size){
+    if(!read_varint(stream, offset, length)){
+      cerr << "ERROR: LZ77 stream is truncated." << endl;
+      return -1;
+    }
+    if(length == 0){
+      if(offset >= stream.size()){
+        cerr << "ERROR: LZ77 stream is truncated." << endl;
+        return -1;
+      }
+      text.push_back(stream[offset]);
+      offset++;
+    }
+    else{
+      if(!read_varint(stream, offset, distance) || distance == 0 ||
+        distance > text.size()){
+        cerr << "ERROR: LZ77 stream has a bad distance." << endl;
+        return -1;
+      }
+      size_t source = text.size() - distance;
+      for(unsigned long long k = 0; k < length; k++){
+        text.push_back(text[source + k]);
+      }
+    }
+  }
+
+  cout << text << endl;
+  return 0;
+}
+
+/**
+ * void compute_LCP_array
+ *
+ * Kasai's linear time LCP construction. LCP_array[i] is the length of the
+ * longest common prefix of the suffixes at SA_array[i-1] and SA_array[i],
+ * and LCP_array[0] is 0. Uses the inverse suffix array (rank of each text
+ * position) so that the lcp of consecutive text positions drops by at most
+ * one.
+ *
+ * The text is a string (without $) or a named T_array (with its unique $,
+ * so no match runs past it).
+ *
+ * @param SA_array The address to the SA array (with the $ suffix).
+ * @param text The address to the text.
+ * @param LCP_array The address to the LCP array.
+ */
+template <typename Text>
+void compute_LCP_array(vector<int> &SA_array, Text &text, vector<int> &LCP_array){
+  int SA_size = (int) SA_array.size();
+  int text_size = (int) text.size();
+  vector<int> rank_array(SA_size);
+  int h = 0;
+
+  LCP_array.assign(SA_size, 0);
+  for(int i = 0; i < SA_size; i++){
+    rank_array[SA_array[i]] = i;
+  }
+
+  for(int p = 0; p < SA_size; p++){
+    if(rank_array[p] == 0){
+      h = 0;
+      continue;
+    }
+    int q = SA_array[rank_array[p] - 1];
+    while(p + h < text_size && q + h < text_size && text[p + h] == text[q + h]){
+      h++;
+    }
+    LCP_array[rank_array[p]] = h;
+    if(h > 0){
+      h--;
+    }
+  }
+}
+
+/**
+ * void build_ESA
+ *
+ * Builds the enhanced suffix array of the text: the LCP array (padded with -1
+ * at both ends) and the child table. The child table combines the up, down
+ * and nextlIndex values of every index in one int per entry:
+ *
+ *   child[i-1] holds up[i] when LCP[i-1] > LCP[i],
+ *   child[i] holds nextlIndex[i] if it exists, else down[i].
+ *
+ * These never collide, so the whole index costs three ints per character.
+ *
+ * @param SA_array The address to the SA array.
+ * @param text The address to the text.
+ * @param esa The address to the enhanced suffix array to fill in.
+ */
+void build_ESA(vector<int> &SA_array, string &text, ESA &esa){
+  int n = (int) SA_array.size();
+  vector<int> stack_array;
+  int last;
+
+  esa.SA = SA_array;
+  compute_LCP_array(SA_array, text, esa.LCP);
+  esa.LCP[0] = -1;
+  esa.LCP.push_back(-1);
+  esa.child.assign(n + 1, -1);
+  stack_array.reserve(n + 1);
+
+  // up and down values
+  stack_array.push_back(0);
+  for(int i = 1; i <= n; i++){
+    last = -1;
+    while(esa.LCP[i] < esa.LCP[stack_array.back()]){
+      last = stack_array.back();
+      stack_array.pop_back();
+      int top = stack_array.back();
+      if(esa.LCP[i] <= esa.LCP[top] && esa.LCP[top] != esa.LCP[last]){
+        esa.child[top] = last;
+      }
+    }
+    if(last != -1){
+      esa.child[i - 1] = last;
+    }
+    stack_array.push_back(i);
+  }
+
+  // nextlIndex values, these replace down values where both exist
+  stack_array.clear();
+  stack_array.push_back(0);
+  for(int i = 1; i <= n; i++){
+    while(esa.LCP[i] < esa.LCP[stack_array.back()]){
+      stack_array.pop_back();
+    }
+    if(esa.LCP[i] == esa.LCP[stack_array.back()]){
+      esa.child[stack_array.back()] = i;
+      stack_array.pop_back();
+    }
+    stack_array.push_back(i);
+  }
+
+  if(DEBUG){
+    cout << "ESA (i, SA, LCP, child):" << endl;
+    for(int i = 0; i <= n; i++){
+      cout << i << ": " << (i < n ? esa.SA[i] : -1) << " " << esa.LCP[i] << " ";
+      cout << esa.child[i] << endl;
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * int get_first_l_index
+ *
+ * Returns the first l-index of the lcp-interval [i..j], i.e. the start of its
+ * second child interval. LCP at that index is the lcp of the interval.
+ *
+ * @param esa The address to the enhanced suffix array.
+ * @param i The left bound of the interval.
+ * @param j The right bound of the interval (i < j).
+ * @return The first l-index of [i..j].
+ */
+int get_first_l_index(ESA &esa, int i, int j){
+  if(i < esa.child[j] && esa.child[j] <= j){
+    return esa.child[j];
+  }
+  return esa.child[i];
+}
+
+/**
+ * int get_child_interval
+ *
+ * Walks the children of the lcp-interval [i..j] in lexicographic order and
+ * finds the one whose suffixes have the character c at offset lcp. This is
+ * O(sigma) child table lookups and one text access per child.
+ *
+ * @param esa The address to the enhanced suffix array.
+ * @param text The address to the text.
+ * @param i The left bound of the interval.
+ * @param j The right bound of the interval.
+ * @param lcp The lcp of the interval.
+ * @param c The character to look for.
+ * @param child_lb The address to store the left bound of the child.
+ * @param child_rb The address to store the right bound of the child.
+ * @return 1 Returns a 1 if the child exists.
+ * @return 0 Returns a 0 if no child starts with c.
+ */
+int get_child_interval(ESA &esa, string &text, int i, int j, int lcp, char c,
+  int &child_lb, int &child_rb){
+  int text_size = (int) text.size();
+  int lb = i;
+  int next = get_first_l_index(esa, i, j);
+
+  while(lb <= j){
+    // The next l-index ends this child, the last child ends at j.
+    int rb = j;
+    if(next != -1){
+      rb = next - 1;
+    }
+
+    int p = esa.SA[lb] + lcp;
+    // p at the end of the text is the $ suffix, it never matches.
+    if(p < text_size){
+      if(text[p] == c){
+        child_lb = lb;
+        child_rb = rb;
+        return 1;
+      }
+      // Children are sorted, so nothing further right can match.
+      if((unsigned char) text[p] > (unsigned char) c){
+        return 0;
+      }
+    }
+
+    if(next == -1){
+      break;
+    }
+    lb = next;
+    if(next < esa.child[next] && esa.child[next] <= j &&
+      esa.LCP[esa.child[next]] == esa.LCP[next]){
+      next = esa.child[next];
+    }
+    else{
+      next = -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * int esa_find
+ *
+ * Top-down search of the pattern in the enhanced suffix array, like walking
+ * down a suffix tree. Each step checks the characters the current interval
+ * shares and then picks the child starting with the next pattern character,
+ * so the search costs O(m * sigma) independent of the text length.
+ *
+ * @param esa The address to the enhanced suffix array.
+ * @param text The address to the text.
+ * @param pattern The address to the pattern.
+ * @param lb The address to store the left bound of the SA interval.
+ * @param rb The address to store the right bound of the SA interval.
+ * @return 1 Returns a 1 if the pattern occurs in the text.
+ * @return 0 Returns a 0 if it does not.
+ */
+int esa_find(ESA &esa, string &text, string &pattern, int &lb, int &rb){
+  int m = (int) pattern.size();
+  int text_size = (int) text.size();
+  int i = 0;
+  int j = (int) esa.SA.size() - 1;
+  int c = 0;
+
+  while(c < m){
+    if(i == j){
+      // A single suffix is left, compare the rest of it directly.
+      int p = esa.SA[i];
+      if(p + m > text_size || text.compare(p + c, m - c, pattern, c, m - c) != 0){
+        return 0;
+      }
+      break;
+    }
+
+    int lcp = esa.LCP[get_first_l_index(esa, i, j)];
+    int end = min(lcp, m);
+    for(int k = c; k < end; k++){
+      if(text[esa.SA[i] + k] != pattern[k]){
+        return 0;
+      }
+    }
+    if(end == m){
+      break;
+    }
+
+    if(!get_child_interval(esa, text, i, j, lcp, pattern[lcp], i, j)){
+      return 0;
+    }
+    c = lcp + 1;
+  }
+
+  lb = i;
+  rb = j;
+  return 1;
+}
+
+/**
+ * void esa_bottom_up_intervals
+ *
+ * Enumerates every lcp-interval of the enhanced suffix array bottom-up, so
+ * each interval comes after all of its children (the root is last). This is
+ * the suffix array equivalent of a post-order traversal of the suffix tree.
+ *
+ * @param esa The address to the enhanced suffix array.
+ * @param intervals The address to the array to append the intervals to.
+ */
+void esa_bottom_up_intervals(ESA &esa, vector<lcp_interval> &intervals){
+  int n = (int) esa.SA.size();
+  vector<lcp_interval> stack_array;
+  lcp_interval root = {0, 0, -1};
+
+  stack_array.push_back(root);
+  for(int i = 1; i <= n; i++){
+    int lb = i - 1;
+    while(!stack_array.empty() && esa.LCP[i] < stack_array.back().lcp){
+      lcp_interval top = stack_array.back();
+      stack_array.pop_back();
+      top.rb = i - 1;
+      intervals.push_back(top);
+      lb = top.lb;
+    }
+    // LCP[n] is -1 and pops the root, nothing is pushed after it.
+    if(i < n && esa.LCP[i] > stack_array.back().lcp){
+      lcp_interval next = {esa.LCP[i], lb, -1};
+      stack_array.push_back(next);
+    }
+  }
+}
+
+/**
+ * int sa_binary_search_count
+ *
+ * The plain way to count a pattern: two binary searches over the SA_array,
+ * each comparing the pattern against the text at O(log n) random positions.
+ *
+ * @param SA_array The address to the SA array.
+ * @param text The address to the text.
+ * @param pattern The address to the pattern.
+ * @return The number of occurrences of the pattern.
+ */
+int sa_binary_search_count(vector<int> &SA_array, string &text, string &pattern){
+  int m = (int) pattern.size();
+  int low = 0;
+  int high = (int) SA_array.size();
+
+  // First suffix that is not smaller than the pattern.
+  while(low < high){
+    int mid = low + (high - low) / 2;
+    if(text.compare(SA_array[mid], m, pattern) < 0){
+      low = mid + 1;
+    }
+    else{
+      high = mid;
+    }
+  }
+  int first = low;
+
+  // First suffix that does not start with the pattern.
+  high = (int) SA_array.size();
+  while(low < high){
+    int mid = low + (high - low) / 2;
+    if(text.compare(SA_array[mid], m, pattern) <= 0){
+      low = mid + 1;
+    }
+    else{
+      high = mid;
+    }
+  }
+  return low - first;
+}
+
+/**
+ * int read_lines
+ *
+ * Reads every line of the file into lines.
+ *
+ * @param file_name The name of the file.
+ * @param lines The address to the array of lines.
+ * @return 1 Returns a 1 if the file was read.
+ * @return 0 Returns a 0 if the file could not be opened.
+ */
+int read_lines(string file_name, vector<string> &lines){
+  ifstream file(file_name.c_str());
+  string read_line;
+
+  if(!file){
+    return 0;
+  }
+  while(getline(file, read_line)){
+    lines.push_back(read_line);
+  }
+  return 1;
+}
+
+/**
+ * int run_esa_mode
+ *
+ * Builds the enhanced suffix array and then, depending on the mode, prints
+ * the number of occurrences of every pattern in the pattern file, times the
+ * top-down search against binary search over SA_array, or prints all
+ * lcp-intervals bottom-up.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param mode One of -esa, -esa-bench or -esa-intervals.
+ * @param pattern_file The file with one pattern per line.
+ * @return -1 Returns an error if the pattern file can't be read.
+ * @return 0 Queries finished.
+ */
+int run_esa_mode(vector<int> &SA_array, string &inputted_string, string mode,
+  string pattern_file){
+  ESA esa;
+  vector<string> patterns;
+  int lb, rb;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  build_ESA(SA_array, inputted_string, esa);
+  double build_seconds = seconds_since(start);
+
+  if(mode == "-esa-intervals"){
+    vector<lcp_interval> intervals;
+    esa_bottom_up_intervals(esa, intervals);
+    for(int k = 0; k < (int) intervals.size(); k++){
+      cout << intervals[k].lcp << " " << intervals[k].lb << " " << intervals[k].rb << endl;
+    }
+    return 0;
+  }
+
+  if(!read_lines(pattern_file, patterns)){
+    cerr << "ERROR: can't read pattern file <" << pattern_file << ">." << endl;
+    return -1;
+  }
+
+  if(mode == "-esa"){
+    for(int k = 0; k < (int) patterns.size(); k++){
+      int count = 0;
+      if(esa_find(esa, inputted_string, patterns[k], lb, rb)){
+        count = rb - lb + 1;
+      }
+      cout << count << endl;
+    }
+    return 0;
+  }
+
+  // Benchmark: same queries through both searches, counts must agree.
+  long long esa_total = 0;
+  long long binary_total = 0;
+  start = chrono::steady_clock::now();
+  for(int k = 0; k < (int) patterns.size(); k++){
+    if(esa_find(esa, inputted_string, patterns[k], lb, rb)){
+      esa_total = esa_total + (rb - lb + 1);
+    }
+  }
+  double esa_seconds = seconds_since(start);
+
+  start = chrono::steady_clock::now();
+  for(int k = 0; k < (int) patterns.size(); k++){
+    binary_total = binary_total + sa_binary_search_count(SA_array, inputted_string,
+      patterns[k]);
+  }
+  double binary_seconds = seconds_since(start);
+
+  if(esa_total != binary_total){
+    cerr << "ERROR: ESA found " << esa_total << " occurrences, binary search found "
+      << binary_total << "." << endl;
+    return -1;
+  }
+
+  double queries = max((int) patterns.size(), 1);
+  cerr << "ESA: " << inputted_string.size() << " bytes, " << patterns.size()
+    << " patterns, " << esa_total << " occurrences" << endl;
+  cerr << "  build:         " << build_seconds << " s, "
+    << 3.0 * sizeof(int) * esa.SA.size() / max((int) inputted_string.size(), 1)
+    << " bytes/char" << endl;
+  cerr << "  ESA search:    " << esa_seconds / queries * 1e9 << " ns/pattern" << endl;
+  cerr << "  binary search: " << binary_seconds / queries * 1e9 << " ns/pattern" << endl;
+  return 0;
+}
+
+/**
+ * int mode_argument_count
+ *
+ * Tells main how many file arguments a mode that reads the text from stdin
+ * needs after the mode itself.
+ *
+ * @param mode The mode given on the command line ("" for the default).
+ * @return The number of file arguments, or -1 if the mode is unknown.
+ */
+int mode_argument_count(string mode){
+  if(mode == "" || mode == "-lz77" || mode == "-lz77-bench" || mode == "-esa-intervals" ||
+    mode == "-csa-bench" || mode == "-pfp" || mode == "-pfp-bench"){
+    return 0;
+  }
+  if(mode == "-esa" || mode == "-esa-bench" || mode == "-csa-build" || mode == "-kmer" ||
+    mode == "-kmer-bench" || mode == "-wm-bench" || mode == "-approx-bench" || mode == "-lce"){
+    return 1;
+  }
+  if(mode == "-approx" || mode == "-approx-edit"){
+    return 2;
+  }
+  return -1;
+}
+
+/**
+ * void bits_append
+ *
+ * Appends the low length bits of value to a bit vector, most significant bit
+ * first.
+ *
+ * @param bits The address to the bit vector.
+ * @param bit_count The address to the number of bits used so far.
+ * @param value The bits to append.
+ * @param length The number of bits to append (0 to 64).
+ */
+void bits_append(vector<unsigned long long> &bits, long long &bit_count,
+  unsigned long long value, int length){
+  if(length == 0){
+    return;
+  }
+  if(length < 64){
+    value = value & ((1ULL << length) - 1);
+  }
+  while((long long) bits.size() * 64 < bit_count + length){
+    bits.push_back(0);
+  }
+
+  long long word = bit_count / 64;
+  int free_bits = 64 - (int) (bit_count % 64);
+  if(length <= free_bits){
+    bits[word] = bits[word] | (value << (free_bits - length));
+  }
+  else{
+    bits[word] = bits[word] | (value >> (length - free_bits));
+    bits[word + 1] = bits[word + 1] | (value << (64 - (length - free_bits)));
+  }
+  bit_count = bit_count + length;
+}
+
+/**
+ * unsigned long long bits_read
+ *
+ * Reads length bits starting at position, most significant bit first. The
+ * bit vector must have one word of padding after the last bit.
+ *
+ * @param bits The address to the bit vector.
+ * @param position The position of the first bit.
+ * @param length The number of bits to read (0 to 64).
+ * @return The bits read.
+ */
+unsigned long long bits_read(vector<unsigned long long> &bits, long long position,
+  int length){
+  if(length == 0){
+    return 0;
+  }
+  long long word = position / 64;
+  int offset = (int) (position % 64);
+  unsigned long long value = bits[word] << offset;
+  if(offset + length > 64){
+    value = value | (bits[word + 1] >> (64 - offset));
+  }
+  return value >> (64 - length);
+}
+
+/**
+ * void elias_delta_append
+ *
+ * Appends value >= 1 in Elias-delta code: the number of bits L of value in
+ * Elias-gamma code, then the L - 1 bits of value below its leading 1.
+ *
+ * @param bits The address to the bit vector.
+ * @param bit_count The address to the number of bits used so far.
+ * @param value The value to append.
+ */
+void elias_delta_append(vector<unsigned long long> &bits, long long &bit_count,
+  unsigned long long value){
+  int length = 64 - __builtin_clzll(value);
+  int length_bits = 32 - __builtin_clz((unsigned int) length);
+
+  // Elias-gamma of length: leading zeros, then length itself.
+  bits_append(bits, bit_count, 0, length_bits - 1);
+  bits_append(bits, bit_count, length, length_bits);
+  bits_append(bits, bit_count, value, length - 1);
+}
+
+/**
+ * unsigned long long elias_delta_read
+ *
+ * Reads one Elias-delta coded value and moves position past it.
+ *
+ * @param bits The address to the bit vector.
+ * @param position The address to the current bit position.
+ * @return The value read.
+ */
+unsigned long long elias_delta_read(vector<unsigned long long> &bits, long long &position){
+  int zeros = __builtin_clzll(bits_read(bits, position, 64));
+  position = position + zeros;
+  int length = (int) bits_read(bits, position, zeros + 1);
+  position = position + zeros + 1;
+  unsigned long long value = bits_read(bits, position, length - 1);
+  position = position + length - 1;
+  if(length > 1){
+    value = value | (1ULL << (length - 1));
+  }
+  else{
+    value = 1;
+  }
+  return value;
+}
+
+/**
+ * void build_CSA
+ *
+ * Builds the compressed suffix array from the output of run_SAIS. Psi is
+ * stored as differences inside each first-character bucket (the first entry
+ * of a bucket is stored as Psi + 1), every CSA_PSI_SAMPLE_RATE-th value
+ * absolutely. The text itself is not kept, csa_first_char recovers the first
+ * character of a suffix from the C array.
+ *
+ * @param SA_array The address to the SA array (with the $ suffix).
+ * @param text The address to the text.
+ * @param csa The address to the compressed suffix array to fill in.
+ */
+void build_CSA(vector<int> &SA_array, string &text, CSA &csa){
+  int N = (int) SA_array.size();
+  vector<int> ISA_array(N);
+  vector<int> occurrences(257, 0);
+
+  csa.size = N;
+  for(int i = 0; i < N; i++){
+    ISA_array[SA_array[i]] = i;
+  }
+
+  // C[c] is 1 (for the $ suffix) plus the number of characters smaller than c.
+  for(int p = 0; p < N - 1; p++){
+    occurrences[(unsigned char) text[p]]++;
+  }
+  csa.C.assign(257, 0);
+  csa.C[0] = 1;
+  for(int c = 1; c <= 256; c++){
+    csa.C[c] = csa.C[c - 1] + occurrences[c - 1];
+  }
+
+  csa.psi_bits.clear();
+  csa.psi_bit_count = 0;
+  int previous = 0;
+  int bucket_end = 1;
+  for(int i = 0; i < N; i++){
+    int p = SA_array[i] + 1;
+    int psi = ISA_array[p < N ? p : 0];
+    bool bucket_start = (i == bucket_end);
+
+    if(bucket_start){
+      bucket_end = *upper_bound(csa.C.begin(), csa.C.end(), i);
+    }
+    if(i % CSA_PSI_SAMPLE_RATE == 0){
+      csa.psi_samples.push_back(psi);
+      csa.psi_pointers.push_back(csa.psi_bit_count);
+    }
+    else if(bucket_start){
+      elias_delta_append(csa.psi_bits, csa.psi_bit_count, psi + 1);
+    }
+    else{
+      elias_delta_append(csa.psi_bits, csa.psi_bit_count, psi - previous);
+    }
+    previous = psi;
+  }
+  // Padding so that reads near the end never run off the vector.
+  csa.psi_bits.push_back(0);
+
+  // Sampled SA values, marked in a bit vector with rank counts per word.
+  csa.sa_marked.assign(N / 64 + 1, 0);
+  for(int i = 0; i < N; i++){
+    if(SA_array[i] % CSA_SA_SAMPLE_RATE == 0 || SA_array[i] == N - 1){
+      csa.sa_marked[i / 64] = csa.sa_marked[i / 64] | (1ULL << (i % 64));
+      csa.sa_samples.push_back(SA_array[i]);
+    }
+  }
+  csa.sa_marked_rank.assign(csa.sa_marked.size(), 0);
+  for(int w = 1; w < (int) csa.sa_marked.size(); w++){
+    csa.sa_marked_rank[w] = csa.sa_marked_rank[w - 1] +
+      __builtin_popcountll(csa.sa_marked[w - 1]);
+  }
+
+  for(int p = 0; p < N; p = p + CSA_SA_SAMPLE_RATE){
+    csa.isa_samples.push_back(ISA_array[p]);
+  }
+}
+
+/**
+ * int csa_psi
+ *
+ * Decodes Psi[i]: starts from the closest sample at or before i and adds up
+ * the differences, restarting at every bucket start on the way.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param i The SA index.
+ * @return Psi[i], the SA index of the suffix one position to the right.
+ */
+int csa_psi(CSA &csa, int i){
+  int sample = i / CSA_PSI_SAMPLE_RATE;
+  int k = sample * CSA_PSI_SAMPLE_RATE;
+  int value = csa.psi_samples[sample];
+  long long position = csa.psi_pointers[sample];
+  int bucket_end = *upper_bound(csa.C.begin(), csa.C.end(), k);
+
+  while(k < i){
+    k++;
+    int code = (int) elias_delta_read(csa.psi_bits, position);
+    if(k == bucket_end){
+      value = code - 1;
+      bucket_end = *upper_bound(csa.C.begin(), csa.C.end(), k);
+    }
+    else{
+      value = value + code;
+    }
+  }
+  return value;
+}
+
+/**
+ * int csa_first_char
+ *
+ * Returns the first character of the suffix at SA index i.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param i The SA index.
+ * @return The character as 0..255, or -1 for the $ suffix.
+ */
+int csa_first_char(CSA &csa, int i){
+  if(i == 0){
+    return -1;
+  }
+  return (int) (upper_bound(csa.C.begin(), csa.C.end(), i) - csa.C.begin()) - 1;
+}
+
+/**
+ * int csa_sa_marked
+ *
+ * Checks whether SA[i] is one of the sampled values.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param i The SA index.
+ * @return 1 Returns a 1 if SA[i] is sampled, 0 if it is not.
+ */
+int csa_sa_marked(CSA &csa, int i){
+  return (int) ((csa.sa_marked[i / 64] >> (i % 64)) & 1);
+}
+
+/**
+ * int csa_lookup_SA
+ *
+ * SA[i]: follows Psi, which moves one text position to the right each step,
+ * until it reaches a sampled position. At most CSA_SA_SAMPLE_RATE steps,
+ * because the $ suffix at the end of the text is always sampled.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param i The SA index.
+ * @return The text position SA[i].
+ */
+int csa_lookup_SA(CSA &csa, int i){
+  int steps = 0;
+  while(!csa_sa_marked(csa, i)){
+    i = csa_psi(csa, i);
+    steps++;
+  }
+  unsigned long long below = csa.sa_marked[i / 64] & ((1ULL << (i % 64)) - 1);
+  int rank = csa.sa_marked_rank[i / 64] + __builtin_popcountll(below);
+  return csa.sa_samples[rank] - steps;
+}
+
+/**
+ * int csa_lookup_ISA
+ *
+ * ISA[p]: starts from the ISA sample at or before p and applies Psi once per
+ * text position to get to p.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param p The text position.
+ * @return The SA index of the suffix starting at p.
+ */
+int csa_lookup_ISA(CSA &csa, int p){
+  int sample = p / CSA_SA_SAMPLE_RATE;
+  int i = csa.isa_samples[sample];
+  for(int k = sample * CSA_SA_SAMPLE_RATE; k < p; k++){
+    i = csa_psi(csa, i);
+  }
+  return i;
+}
+
+/**
+ * int csa_compare_suffix
+ *
+ * Compares the pattern with the first m characters of the suffix at SA index
+ * i, reading them with csa_first_char and Psi.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param i The SA index.
+ * @param pattern The address to the pattern.
+ * @return -1, 0 or 1 if the suffix prefix is smaller, equal or larger.
+ */
+int csa_compare_suffix(CSA &csa, int i, string &pattern){
+  for(int k = 0; k < (int) pattern.size(); k++){
+    int c = csa_first_char(csa, i);
+    int pattern_char = (unsigned char) pattern[k];
+    if(c < pattern_char){
+      return -1;
+    }
+    if(c > pattern_char){
+      return 1;
+    }
+    i = csa_psi(csa, i);
+  }
+  return 0;
+}
+
+/**
+ * int csa_count
+ *
+ * Counts the occurrences of the pattern with two binary searches over the
+ * SA indexes, like sa_binary_search_count but without the text.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param pattern The address to the pattern.
+ * @return The number of occurrences.
+ */
+int csa_count(CSA &csa, string &pattern){
+  int low = 0;
+  int high = csa.size;
+  while(low < high){
+    int mid = low + (high - low) / 2;
+    if(csa_compare_suffix(csa, mid, pattern) < 0){
+      low = mid + 1;
+    }
+    else{
+      high = mid;
+    }
+  }
+  int first = low;
+
+  high = csa.size;
+  while(low < high){
+    int mid = low + (high - low) / 2;
+    if(csa_compare_suffix(csa, mid, pattern) <= 0){
+      low = mid + 1;
+    }
+    else{
+      high = mid;
+    }
+  }
+  return low - first;
+}
+
+/**
+ * long long csa_size_in_bits
+ *
+ * The space the compressed suffix array takes, all parts included.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @return The size in bits.
+ */
+long long csa_size_in_bits(CSA &csa){
+  long long bits = 0;
+  bits = bits + 32LL * csa.C.size();
+  bits = bits + 64LL * csa.psi_bits.size();
+  bits = bits + 32LL * csa.psi_samples.size() + 64LL * csa.psi_pointers.size();
+  bits = bits + 64LL * csa.sa_marked.size() + 32LL * csa.sa_marked_rank.size();
+  bits = bits + 32LL * csa.sa_samples.size() + 32LL * csa.isa_samples.size();
+  return bits;
+}
+
+/**
+ * void write_array
+ *
+ * Writes the size and the elements of an array to a binary file.
+ *
+ * @param file The address to the output file.
+ * @param array The address to the array.
+ */
+template <typename V>
+void write_array(ofstream &file, vector<V> &array){
+  long long size = (long long) array.size();
+  file.write((char *) &size, sizeof(size));
+  file.write((char *) array.data(), size * sizeof(V));
+}
+
+/**
+ * int read_array
+ *
+ * Reads an array written by write_array.
+ *
+ * @param file The address to the input file.
+ * @param array The address to the array.
+ * @return 1 Returns a 1 if the array was read, 0 if the file ended.
+ */
+template <typename V>
+int read_array(ifstream &file, vector<V> &array){
+  long long size = 0;
+  if(!file.read((char *) &size, sizeof(size)) || size < 0){
+    return 0;
+  }
+  array.resize(size);
+  file.read((char *) array.data(), size * sizeof(V));
+  return file ? 1 : 0;
+}
+
+/**
+ * int save_CSA
+ *
+ * Saves the compressed suffix array to a binary file.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param file_name The name of the file.
+ * @return 1 Returns a 1 if the file was written, 0 if not.
+ */
+int save_CSA(CSA &csa, string file_name){
+  ofstream file(file_name.c_str(), ios::binary);
+  if(!file){
+    return 0;
+  }
+  file.write("CSA1", 4);
+  file.write((char *) &csa.size, sizeof(csa.size));
+  file.write((char *) &csa.psi_bit_count, sizeof(csa.psi_bit_count));
+  write_array(file, csa.C);
+  write_array(file, csa.psi_bits);
+  write_array(file, csa.psi_samples);
+  write_array(file, csa.psi_pointers);
+  write_array(file, csa.sa_marked);
+  write_array(file, csa.sa_marked_rank);
+  write_array(file, csa.sa_samples);
+  write_array(file, csa.isa_samples);
+  return file ? 1 : 0;
+}
+
+/**
+ * int load_CSA
+ *
+ * Loads a compressed suffix array saved by save_CSA. Every array must have
+ * the length build_CSA gives it for csa.size, and psi_bit_count must fit in
+ * psi_bits, otherwise the queries would read past them.
+ *
+ * @param csa The address to the compressed suffix array.
+ * @param file_name The name of the file.
+ * @return 1 Returns a 1 if the file was read, 0 if not.
+ */
+int load_CSA(CSA &csa, string file_name){
+  ifstream file(file_name.c_str(), ios::binary);
+  char magic[4];
+  if(!file || !file.read(magic, 4) || string(magic, 4) != "CSA1"){
+    return 0;
+  }
+  file.read((char *) &csa.size, sizeof(csa.size));
+  file.read((char *) &csa.psi_bit_count, sizeof(csa.psi_bit_count));
+  if(!file || csa.size < 1 || !read_array(file, csa.C) || !read_array(file, csa.psi_bits) ||
+    !read_array(file, csa.psi_samples) || !read_array(file, csa.psi_pointers) ||
+    !read_array(file, csa.sa_marked) || !read_array(file, csa.sa_marked_rank) ||
+    !read_array(file, csa.sa_samples) || !read_array(file, csa.isa_samples)){
+    return 0;
+  }
+
+  size_t N = csa.size;
+  size_t psi_sample_count = (N + CSA_PSI_SAMPLE_RATE - 1) / CSA_PSI_SAMPLE_RATE;
+  if(csa.C.size() != 257 || csa.C[0] != 1 || csa.C[256] != csa.size ||
+    csa.psi_samples.size() != psi_sample_count || csa.psi_pointers.size() != psi_sample_count ||
+    csa.sa_marked.size() != N / 64 + 1 || csa.sa_marked_rank.size() != N / 64 + 1 ||
+    csa.isa_samples.size() != (N + CSA_SA_SAMPLE_RATE - 1) / CSA_SA_SAMPLE_RATE ||
+    csa.psi_bit_count < 0 || csa.psi_bit_count > 64LL * (long long) csa.psi_bits.size()){
+    return 0;
+  }
+  for(int c = 1; c <= 256; c++){
+    if(csa.C[c] < csa.C[c - 1]){
+      return 0;
+    }
+  }
+  size_t marked = csa.sa_marked_rank.back() + __builtin_popcountll(csa.sa_marked.back());
+  return csa.sa_samples.size() == marked ? 1 : 0;
+}
+
+/**
+ * int run_csa_mode
+ *
+ * Builds the compressed suffix array and either saves it to csa_file or
+ * benchmarks it against the plain SA_array: space in bits per character, and
+ * the average time of SA[i], ISA[p] and count queries at random positions.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param mode Either -csa-build or -csa-bench.
+ * @param csa_file The file to save the CSA to.
+ * @return -1 Returns an error if the file can't be written or the CSA
+ *         disagrees with the plain SA.
+ * @return 0 Finished.
+ */
+int run_csa_mode(vector<int> &SA_array, string &inputted_string, string mode,
+  string csa_file){
+  CSA csa;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  build_CSA(SA_array, inputted_string, csa);
+  double build_seconds = seconds_since(start);
+
+  if(mode == "-csa-build"){
+    if(!save_CSA(csa, csa_file)){
+      cerr << "ERROR: can't write CSA file <" << csa_file << ">." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  int N = csa.size;
+  int queries = 100000;
+  vector<int> positions(queries);
+  vector<int> ISA_array(N);
+  unsigned int seed = 12345;
+  for(int q = 0; q < queries; q++){
+    seed = seed * 1103515245 + 12345;
+    positions[q] = (int) ((seed >> 8) % N);
+  }
+  for(int i = 0; i < N; i++){
+    ISA_array[SA_array[i]] = i;
+  }
+
+  long long plain_sum = 0;
+  long long csa_sum = 0;
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < queries; q++){
+    plain_sum = plain_sum + SA_array[positions[q]];
+  }
+  double plain_sa_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < queries; q++){
+    csa_sum = csa_sum + csa_lookup_SA(csa, positions[q]);
+  }
+  double csa_sa_seconds = seconds_since(start);
+
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < queries; q++){
+    plain_sum = plain_sum + ISA_array[positions[q]];
+  }
+  double plain_isa_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < queries; q++){
+    csa_sum = csa_sum + csa_lookup_ISA(csa, positions[q]);
+  }
+  double csa_isa_seconds = seconds_since(start);
+
+  // Count patterns of length 8 taken from random text positions.
+  int count_queries = min(queries / 10, N);
+  vector<string> patterns;
+  for(int q = 0; q < count_queries; q++){
+    patterns.push_back(inputted_string.substr(min(positions[q], N - 1), 8));
+  }
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < count_queries; q++){
+    plain_sum = plain_sum + sa_binary_search_count(SA_array, inputted_string, patterns[q]);
+  }
+  double plain_count_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  for(int q = 0; q < count_queries; q++){
+    csa_sum = csa_sum + csa_count(csa, patterns[q]);
+  }
+  double csa_count_seconds = seconds_since(start);
+
+  if(plain_sum != csa_sum){
+    cerr << "ERROR: CSA answers differ from the plain SA." << endl;
+    return -1;
+  }
+
+  double chars = max((int) inputted_string.size(), 1);
+  cerr << "CSA: " << inputted_string.size() << " bytes, built in " << build_seconds
+    << " s" << endl;
+  cerr << "  space:  CSA " << csa_size_in_bits(csa) / chars << " bits/char, plain SA "
+    << 32.0 * N / chars << " bits/char (+ text " << 8 << ")" << endl;
+  cerr << "  SA[i]:  CSA " << csa_sa_seconds / queries * 1e9 << " ns, plain "
+    << plain_sa_seconds / queries * 1e9 << " ns" << endl;
+  cerr << "  ISA[p]: CSA " << csa_isa_seconds / queries * 1e9 << " ns, plain "
+    << plain_isa_seconds / queries * 1e9 << " ns" << endl;
+  cerr << "  count:  CSA " << csa_count_seconds / max(count_queries, 1) * 1e9
+    << " ns, plain " << plain_count_seconds / max(count_queries, 1) * 1e9 << " ns" << endl;
+  return 0;
+}
+
+/**
+ * int run_csa_query
+ *
+ * Loads a saved compressed suffix array and answers the queries in the
+ * query file, one answer per line:
+ *
+ *   sa i       the text position SA[i]
+ *   isa p      the SA index of the suffix at text position p
+ *   count P    the number of occurrences of P (the rest of the line)
+ *
+ * @param csa_file The file saved by -csa-build.
+ * @param query_file The file with one query per line.
+ * @return -1 Returns an error if a file can't be read or a query is bad.
+ * @return 0 All queries answered.
+ */
+int run_csa_query(string csa_file, string query_file){
+  CSA csa;
+  vector<string> queries;
+
+  if(!load_CSA(csa, csa_file)){
+    cerr << "ERROR: can't read CSA file <" << csa_file << ">." << endl;
+    return -1;
+  }
+  if(!read_lines(query_file, queries)){
+    cerr << "ERROR: can't read query file <" << query_file << ">." << endl;
+    return -1;
+  }
+
+  for(int q = 0; q < (int) queries.size(); q++){
+    string query = queries[q];
+    if(query.compare(0, 6, "count ") == 0){
+      string pattern = query.substr(6);
+      cout << csa_count(csa, pattern) << endl;
+      continue;
+    }
+
+    istringstream words(query);
+    string kind;
+    long long value;
+    if(!(words >> kind >> value) || (kind != "sa" && kind != "isa") || value < 0 ||
+      value >= csa.size){
+      cerr << "ERROR: bad query <" << query << ">." << endl;
+      return -1;
+    }
+    if(kind == "sa"){
+      cout << csa_lookup_SA(csa, (int) value) << endl;
+    }
+    else{
+      cout << csa_lookup_ISA(csa, (int) value) << endl;
+    }
+  }
+  return 0;
+}
+
+/**
+ * int parse_k_list
+ *
+ * Parses a comma separated list of k values, like "3,5,7".
+ *
+ * @param k_list The list from the command line.
+ * @param k_values The address to the array of k values.
+ * @return 1 Returns a 1 if every k is a positive number, 0 if not.
+ */
+int parse_k_list(string k_list, vector<int> &k_values){
+  istringstream list(k_list);
+  string item;
+  while(getline(list, item, ',')){
+    int k = atoi(item.c_str());
+    if(k <= 0){
+      return 0;
+    }
+    k_values.push_back(k);
+  }
+  return k_values.empty() ? 0 : 1;
+}
+
+/**
+ * void count_kmers
+ *
+ * Counts every k-mer for all k in k_values with one scan over SA and LCP.
+ * The suffixes starting with the same k-mer are consecutive in SA, and a
+ * new group starts exactly where LCP[i] < k. So each k only keeps the start
+ * of its current group, and the group's size is the count of its k-mer. A
+ * group whose first suffix is shorter than k holds no k-mer. No hash table
+ * is involved, and the k-mers come out in lexicographic order for each k.
+ *
+ * @param SA_array The address to the SA array.
+ * @param LCP_array The address to the LCP array.
+ * @param text The address to the text.
+ * @param k_values The address to the array of k values.
+ * @param min_count Only k-mers occurring at least this often are reported.
+ * @param output Where to append "kmer count" lines, or NULL to only count.
+ * @param distinct The address to the number of k-mers reported.
+ */
+void count_kmers(vector<int> &SA_array, vector<int> &LCP_array, string &text,
+  vector<int> &k_values, int min_count, string *output, long long &distinct){
+  int N = (int) SA_array.size();
+  int text_size = (int) text.size();
+  int k_count = (int) k_values.size();
+  vector<int> group_start(k_count, 0);
+
+  distinct = 0;
+  for(int i = 1; i <= N; i++){
+    for(int k = 0; k < k_count; k++){
+      if(i < N && LCP_array[i] >= k_values[k]){
+        continue;
+      }
+      // Group [group_start, i) ends here.
+      int start = group_start[k];
+      int count = i - start;
+      if(text_size - SA_array[start] >= k_values[k] && count >= min_count){
+        distinct++;
+        if(output != NULL){
+          output->append(text, SA_array[start], k_values[k]);
+          output->push_back(' ');
+          output->append(to_string(count));
+          output->push_back('\n');
+        }
+      }
+      group_start[k] = i;
+    }
+
+    // Write out in large pieces.
+    if(output != NULL && output->size() > (1 << 20)){
+      cout.write(output->data(), output->size());
+      output->clear();
+    }
+  }
+}
+
+/**
+ * long long count_kmers_hash_map
+ *
+ * The hash map way of counting k-mers, for the benchmark.
+ *
+ * @param text The address to the text.
+ * @param k_values The address to the array of k values.
+ * @param min_count Only k-mers occurring at least this often are counted.
+ * @return The number of distinct k-mers with at least min_count occurrences.
+ */
+long long count_kmers_hash_map(string &text, vector<int> &k_values, int min_count){
+  long long distinct = 0;
+  for(int k = 0; k < (int) k_values.size(); k++){
+    unordered_map<string, int> counts;
+    for(int p = 0; p + k_values[k] <= (int) text.size(); p++){
+      counts[text.substr(p, k_values[k])]++;
+    }
+    for(unordered_map<string, int>::iterator it = counts.begin(); it != counts.end(); it++){
+      if(it->second >= min_count){
+        distinct++;
+      }
+    }
+  }
+  return distinct;
+}
+
+/**
+ * int run_kmer_mode
+ *
+ * Builds the LCP array and prints the k-mer spectrum of the text, or for the
+ * benchmark, times the SA/LCP scan against a hash map counter on the same
+ * input and checks that both find the same number of distinct k-mers.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param k_list The comma separated k values.
+ * @param min_count The minimum count to report.
+ * @param benchmark True to only report timings.
+ * @param sais_seconds Time spent in run_SAIS.
+ * @return -1 Returns an error for a bad k list or a benchmark mismatch.
+ * @return 0 Finished.
+ */
+int run_kmer_mode(vector<int> &SA_array, string &inputted_string, string k_list,
+  int min_count, bool benchmark, double sais_seconds){
+  vector<int> k_values;
+  vector<int> LCP_array;
+  long long distinct = 0;
+
+  if(!parse_k_list(k_list, k_values)){
+    cerr << "ERROR: bad k list <" << k_list << ">." << endl;
+    return -1;
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  compute_LCP_array(SA_array, inputted_string, LCP_array);
+  double lcp_seconds = seconds_since(start);
+
+  if(!benchmark){
+    string output;
+    count_kmers(SA_array, LCP_array, inputted_string, k_values, min_count, &output,
+      distinct);
+    cout.write(output.data(), output.size());
+    return 0;
+  }
+
+  start = chrono::steady_clock::now();
+  count_kmers(SA_array, LCP_array, inputted_string, k_values, min_count, NULL, distinct);
+  double scan_seconds = seconds_since(start);
+
+  start = chrono::steady_clock::now();
+  long long hash_distinct = count_kmers_hash_map(inputted_string, k_values, min_count);
+  double hash_seconds = seconds_since(start);
+
+  if(distinct != hash_distinct){
+    cerr << "ERROR: SA scan found " << distinct << " k-mers, hash map found "
+      << hash_distinct << "." << endl;
+    return -1;
+  }
+
+  double megabytes = inputted_string.size() / 1000000.0;
+  cerr << "k-mers: " << inputted_string.size() << " bytes, k = " << k_list << ", "
+    << distinct << " distinct" << endl;
+  cerr << "  SAIS + LCP + scan: " << sais_seconds + lcp_seconds + scan_seconds << " s ("
+    << megabytes / (sais_seconds + lcp_seconds + scan_seconds) << " MB/s), scan alone "
+    << scan_seconds << " s" << endl;
+  cerr << "  hash map:          " << hash_seconds << " s (" << megabytes / hash_seconds
+    << " MB/s)" << endl;
+  return 0;
+}
+
+/**
+ * Packed_DNA_text
+ *
+ * Constructor. Starts with an empty text.
+ */
+Packed_DNA_text::Packed_DNA_text(){
+  number_of_bases = 0;
+  for(int code = 0; code < 4; code++){
+    names[code] = 0;
+  }
+}
+
+/**
+ * int append
+ *
+ * Packs the bases at the end of the text.
+ *
+ * @param bases The address to the bases to append.
+ * @return 1 Returns a 1 if all of them were A, C, G or T.
+ * @return 0 Returns a 0 at the first other character.
+ */
+int Packed_DNA_text::append(string &bases){
+  for(int k = 0; k < (int) bases.size(); k++){
+    unsigned long long code;
+    switch(bases[k]){
+      case 'A': code = 0; break;
+      case 'C': code = 1; break;
+      case 'G': code = 2; break;
+      case 'T': code = 3; break;
+      default: return 0;
+    }
+    if(number_of_bases % 32 == 0){
+      words.push_back(0);
+    }
+    words.back() = words.back() | (code << (62 - 2 * (number_of_bases % 32)));
+    // Until finish() names only records which bases occur.
+    names[code] = 1;
+    number_of_bases++;
+  }
+  return 1;
+}
+
+/**
+ * void finish
+ *
+ * Call once all bases are appended. Gives the bases that occur dense names
+ * from 1, like assign_index_to_T, and pads the words so get_word can always
+ * read the word after the last one.
+ */
+void Packed_DNA_text::finish(){
+  int counter_index = 1;
+  for(int code = 0; code < 4; code++){
+    if(names[code]){
+      names[code] = counter_index;
+      counter_index = counter_index + 1;
+    }
+  }
+  words.push_back(0);
+}
+
+/**
+ * int operator[]
+ *
+ * The name of the base at position i, or 0 for the $ at position n.
+ *
+ * @param i The position.
+ * @return The name of the character at i.
+ */
+int Packed_DNA_text::operator[](int i) const{
+  if(i == number_of_bases){
+    return 0;
+  }
+  return names[(words[i >> 5] >> (62 - 2 * (i & 31))) & 3];
+}
+
+/**
+ * size_t size
+ *
+ * The size of the text, the $ included (like T_array.size()).
+ *
+ * @return The number of bases plus one.
+ */
+size_t Packed_DNA_text::size() const{
+  return number_of_bases + 1;
+}
+
+/**
+ * unsigned long long get_word
+ *
+ * The 2-bit codes of the 32 bases starting at i, the base at i in the high
+ * bits. i + 32 must not be past the last base.
+ *
+ * @param i The first position.
+ * @return The 32 codes.
+ */
+unsigned long long Packed_DNA_text::get_word(int i) const{
+  int offset = 2 * (i & 31);
+  if(offset == 0){
+    return words[i >> 5];
+  }
+  return (words[i >> 5] << offset) | (words[(i >> 5) + 1] >> (64 - offset));
+}
+
+/**
+ * char get_base
+ *
+ * The base at position i as a letter.
+ *
+ * @param i The position (not the $).
+ * @return 'A', 'C', 'G' or 'T'.
+ */
+char Packed_DNA_text::get_base(int i) const{
+  return "ACGT"[(words[i >> 5] >> (62 - 2 * (i & 31))) & 3];
+}
+
+/**
+ * int compare_lms_substrings
+ *
+ * compare_lms_substrings for the packed DNA text. The two LMS substrings are
+ * compared 32 bases at a time: XOR of the two words, and the leading zeros
+ * give how many bases are equal. Only those positions need the type checks.
+ * Near the end of the text (less than 32 bases left) it goes one base at a
+ * time like the generic version.
+ *
+ * @param S_type_array The address of the S_type_array.
+ * @param T_array The address of the packed text.
+ * @param previous The previous LMS-substring.
+ * @param p The position of SA[i] in T.
+ * @return 1 Returns a 1 if the LMS substrings are identical.
+ * @return 0 Returns a 0 if the LMS substrings are not identical.
+ */
+int compare_lms_substrings(vector<int> &S_type_array, Packed_DNA_text &T_array,
+  int previous, int p){
+  int last = (int) T_array.size() - 1;
+  bool started = true;
+
+  while(1){
+    // Number of positions from here on with equal characters, and whether
+    // the character right after them is known to differ.
+    int equal_run;
+    bool mismatch_after;
+    if(previous + 32 <= last && p + 32 <= last){
+      unsigned long long difference = T_array.get_word(previous) ^ T_array.get_word(p);
+      equal_run = (difference == 0) ? 32 : __builtin_clzll(difference) / 2;
+      mismatch_after = (difference != 0);
+    }
+    else{
+      equal_run = (T_array[previous] == T_array[p]) ? 1 : 0;
+      mismatch_after = (equal_run == 0);
+    }
+
+    for(int k = 0; k < equal_run; k++){
+      if(S_type_array[previous] != S_type_array[p]){
+        return 0;
+      }
+      if((S_type_array[previous] == 1 && !started && S_type_array[previous-1] == 0) ||
+        previous == last){
+        return 1;
+      }
+      if((S_type_array[p] == 1 && !started && S_type_array[p-1] == 0) || p == last){
+        return 1;
+      }
+      previous = previous + 1;
+      p = p + 1;
+      started = false;
+    }
+
+    if(mismatch_after){
+      return 0;
+    }
+  }
+}
+
+/**
+ * void print_BWT
+ *
+ * print_BWT for the packed DNA text. Writes the BWT in large pieces.
+ *
+ * @param SA_array The address to the SA array.
+ * @param text The address to the packed text.
+ */
+void print_BWT(vector<int> &SA_array, Packed_DNA_text &text){
+  string output;
+  for(int i = 0; i < (int) SA_array.size(); i++){
+    int p = SA_array[i] - 1;
+    if(p >= 0){
+      output.push_back(text.get_base(p));
+    }
+    if(output.size() >= (1 << 20)){
+      cout.write(output.data(), output.size());
+      output.clear();
+    }
+  }
+  output.push_back('\n');
+  cout.write(output.data(), output.size());
+}
+
+/**
+ * int run_dna_mode
+ *
+ * Reads a DNA text from stdin straight into a Packed_DNA_text, line by line,
+ * runs SAIS on it and prints the BWT. The text never exists as a string or
+ * as an int per base.
+ *
+ * @return -1 Returns an error if the input has other characters.
+ * @return 0 Finished.
+ */
+int run_dna_mode(){
+  Packed_DNA_text text;
+  string read_line;
+  int recursion_counter = 0;
+
+  while(getline(cin, read_line)){
+    if(!text.append(read_line)){
+      cerr << "ERROR: -dna input must only contain A, C, G and T." << endl;
+      return -1;
+    }
+  }
+  text.finish();
+
+  vector<int> SA_array(text.size(), -1);
+  run_SAIS(SA_array, text, (int) text.size(), recursion_counter);
+  print_BWT(SA_array, text);
+  return 0;
+}
+
+/**
+ * unsigned int crc32
+ *
+ * The CRC-32 (IEEE, reflected, the one zip and gzip use) of len bytes. The
+ * table is built the first time it is needed.
+ *
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @return The checksum.
+ */
+unsigned int crc32(const char *data, size_t len){
+  static const vector<unsigned int> table = make_crc32_table();
+  unsigned int crc = 0xFFFFFFFFu;
+  for(size_t i = 0; i < len; i++){
+    crc = table[(crc ^ (unsigned char) data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * vector<unsigned int> make_crc32_table
+ *
+ * The 256 entry lookup table for crc32().
+ *
+ * @return The table.
+ */
+vector<unsigned int> make_crc32_table(){
+  vector<unsigned int> table(256);
+  for(unsigned int i = 0; i < 256; i++){
+    unsigned int c = i;
+    for(int k = 0; k < 8; k++){
+      c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+    }
+    table[i] = c;
+  }
+  return table;
+}
+
+/**
+ * void append_u32
+ *
+ * Appends a 32-bit value to a byte stream, little endian.
+ *
+ * @param stream The address to the byte stream.
+ * @param value The value.
+ */
+void append_u32(string &stream, unsigned int value){
+  for(int k = 0; k < 4; k++){
+    stream.push_back((char) ((value >> (8 * k)) & 0xFF));
+  }
+}
+
+/**
+ * int read_u32
+ *
+ * Reads a 32-bit little endian value from a byte stream at offset and moves
+ * offset past it.
+ *
+ * @param stream The address to the byte stream.
+ * @param offset The address to the read position.
+ * @param value The address to store the value in.
+ * @return 0 Returns a 0 if the stream ends first.
+ * @return 1 Returns a 1 if a value was read.
+ */
+int read_u32(string &stream, size_t &offset, unsigned int &value){
+  if(offset + 4 > stream.size()){
+    return 0;
+  }
+  value = 0;
+  for(int k = 0; k < 4; k++){
+    value = value | ((unsigned int) (unsigned char) stream[offset + k] << (8 * k));
+  }
+  offset = offset + 4;
+  return 1;
+}
+
+/**
+ * Range_encoder
+ *
+ * Binary adaptive range coder (the LZMA one). Probabilities are 11-bit
+ * estimates of a 0 bit and move 1/32 of the way towards each coded bit.
+ * Carries are handled with a cached byte plus a count of pending 0xFF bytes.
+ *
+ * @param output The address to the byte stream the code is appended to.
+ */
+Range_encoder::Range_encoder(string &output) : output(output){
+  low = 0;
+  range = 0xFFFFFFFFu;
+  cache = 0;
+  cache_size = 1;
+}
+
+/**
+ * void encode_bit
+ *
+ * Codes one bit with the given probability and updates the probability.
+ *
+ * @param probability The address to the probability of a 0.
+ * @param bit The bit.
+ */
+void Range_encoder::encode_bit(unsigned short &probability, int bit){
+  unsigned int bound = (range >> RANGE_PROBABILITY_BITS) * probability;
+  if(bit == 0){
+    range = bound;
+    probability = probability + (((1 << RANGE_PROBABILITY_BITS) - probability) >> RANGE_ADAPT_SHIFT);
+  }
+  else{
+    low = low + bound;
+    range = range - bound;
+    probability = probability - (probability >> RANGE_ADAPT_SHIFT);
+  }
+  while(range < (1u << 24)){
+    range = range << 8;
+    shift_low();
+  }
+}
+
+/**
+ * void encode_symbol
+ *
+ * Codes a BWZ_SYMBOL_BITS wide symbol with a bit tree of probabilities, high
+ * bit first, each bit in the context of the bits before it.
+ *
+ * @param tree The address to the 1 << BWZ_SYMBOL_BITS probabilities.
+ * @param symbol The symbol.
+ */
+void Range_encoder::encode_symbol(vector<unsigned short> &tree, int symbol){
+  int node = 1;
+  for(int k = BWZ_SYMBOL_BITS - 1; k >= 0; k--){
+    int bit = (symbol >> k) & 1;
+    encode_bit(tree[node], bit);
+    node = (node << 1) | bit;
+  }
+}
+
+/**
+ * void flush
+ *
+ * Writes out the rest of low. Has to be called once after the last bit.
+ */
+void Range_encoder::flush(){
+  for(int k = 0; k < 5; k++){
+    shift_low();
+  }
+}
+
+/**
+ * void shift_low
+ *
+ * Moves the top byte of low to the output. The byte is held back while it
+ * could still get a carry.
+ */
+void Range_encoder::shift_low(){
+  if((unsigned int) low < 0xFF000000u || (low >> 32) != 0){
+    unsigned char carry = (unsigned char) (low >> 32);
+    unsigned char byte = cache;
+    do{
+      output.push_back((char) (unsigned char) (byte + carry));
+      byte = 0xFF;
+    } while(--cache_size != 0);
+    cache = (unsigned char) ((low >> 24) & 0xFF);
+  }
+  cache_size++;
+  low = (low & 0x00FFFFFFu) << 8;
+}
+
+/**
+ * Range_decoder
+ *
+ * Decoder for Range_encoder, reading the code from stream between offset and
+ * end. Reading past end gives 0 bytes, so a damaged stream decodes to garbage
+ * (which the block checksum catches) instead of running off the buffer.
+ *
+ * @param stream The address to the byte stream.
+ * @param offset Where the code starts.
+ * @param end Where the code ends.
+ */
+Range_decoder::Range_decoder(string &stream, size_t offset, size_t end) : stream(stream){
+  position = offset;
+  this->end = end;
+  range = 0xFFFFFFFFu;
+  code = 0;
+  for(int k = 0; k < 5; k++){
+    code = (code << 8) | next_byte();
+  }
+}
+
+/**
+ * int decode_bit
+ *
+ * Decodes one bit and updates the probability the same way the encoder did.
+ *
+ * @param probability The address to the probability of a 0.
+ * @return The bit.
+ */
+int Range_decoder::decode_bit(unsigned short &probability){
+  unsigned int bound = (range >> RANGE_PROBABILITY_BITS) * probability;
+  int bit;
+  if(code < bound){
+    range = bound;
+    probability = probability + (((1 << RANGE_PROBABILITY_BITS) - probability) >> RANGE_ADAPT_SHIFT);
+    bit = 0;
+  }
+  else{
+    code = code - bound;
+    range = range - bound;
+    probability = probability - (probability >> RANGE_ADAPT_SHIFT);
+    bit = 1;
+  }
+  while(range < (1u << 24)){
+    range = range << 8;
+    code = (code << 8) | next_byte();
+  }
+  return bit;
+}
+
+/**
+ * int decode_symbol
+ *
+ * Decodes a symbol coded with Range_encoder::encode_symbol.
+ *
+ * @param tree The address to the 1 << BWZ_SYMBOL_BITS probabilities.
+ * @return The symbol.
+ */
+int Range_decoder::decode_symbol(vector<unsigned short> &tree){
+  int node = 1;
+  for(int k = 0; k < BWZ_SYMBOL_BITS; k++){
+    node = (node << 1) | decode_bit(tree[node]);
+  }
+  return node - (1 << BWZ_SYMBOL_BITS);
+}
+
+/**
+ * unsigned int next_byte
+ *
+ * The next byte of the code, 0 past the end.
+ *
+ * @return The byte.
+ */
+unsigned int Range_decoder::next_byte(){
+  if(position >= end){
+    return 0;
+  }
+  return (unsigned char) stream[position++];
+}
+
+/**
+ * void compress_block
+ *
+ * Compresses one block: BWT with run_SAIS (the $ row is left out and its
+ * position kept as the primary index), move-to-front, bzip2-style zero runs
+ * (the run length written in bijective base 2 with RUNA and RUNB) and the
+ * range coder with one adaptive bit tree for the whole block.
+ *
+ * @param block The address to the raw bytes of the block.
+ * @param result The address to the compressed block.
+ */
+void compress_block(string &block, Compressed_block &result){
+  int size_of_string = (int) block.size() + 1;
+  int recursion_counter = 0;
+  vector<int> T_array(size_of_string);
+  vector<int> SA_array(size_of_string, -1);
+
+  result.raw_length = (int) block.size();
+  result.crc = crc32(block.data(), block.size());
+  result.payload.clear();
+
+  assign_index_to_T(T_array, block, size_of_string);
+  run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+
+  // BWT bytes in MTF order. The $ row is always row 0 of SA (the $ suffix),
+  // the primary index is the row whose rotation is the whole block.
+  unsigned char order[256];
+  for(int c = 0; c < 256; c++){
+    order[c] = (unsigned char) c;
+  }
+  vector<unsigned short> tree(1 << BWZ_SYMBOL_BITS, 1 << (RANGE_PROBABILITY_BITS - 1));
+  Range_encoder encoder(result.payload);
+  int zero_run = 0;
+
+  for(int i = 0; i < size_of_string; i++){
+    if(SA_array[i] == 0){
+      result.primary = i;
+      continue;
+    }
+    unsigned char c = (unsigned char) block[SA_array[i] - 1];
+    int rank = 0;
+    while(order[rank] != c){
+      rank++;
+    }
+    for(int k = rank; k > 0; k--){
+      order[k] = order[k - 1];
+    }
+    order[0] = c;
+
+    if(rank == 0){
+      zero_run++;
+      continue;
+    }
+    encode_zero_run(encoder, tree, zero_run);
+    zero_run = 0;
+    encoder.encode_symbol(tree, rank + 1);
+  }
+  encode_zero_run(encoder, tree, zero_run);
+  encoder.encode_symbol(tree, BWZ_EOB);
+  encoder.flush();
+  result.payload_length = (int) result.payload.size();
+}
+
+/**
+ * void encode_zero_run
+ *
+ * Codes a run of MTF zeros: run + 1 in binary without its top bit, lowest bit
+ * first, RUNA for a 0 bit and RUNB for a 1 bit. Nothing for an empty run.
+ *
+ * @param encoder The address to the range encoder.
+ * @param tree The address to the symbol probabilities.
+ * @param run The length of the run.
+ */
+void encode_zero_run(Range_encoder &encoder, vector<unsigned short> &tree, int run){
+  if(run == 0){
+    return;
+  }
+  unsigned int value = (unsigned int) run + 1;
+  while(value > 1){
+    encoder.encode_symbol(tree, (value & 1) ? BWZ_RUNB : BWZ_RUNA);
+    value = value >> 1;
+  }
+}
+
+/**
+ * int decompress_block
+ *
+ * Undoes compress_block: decodes the symbols back to the BWT bytes, puts the
+ * $ back at the primary index and walks LF from the $ row to rebuild the
+ * block from its last byte to its first.
+ *
+ * @param stream The address to the compressed file.
+ * @param offset Where the payload of the block starts.
+ * @param info The header of the block (payload is not used).
+ * @param block The address to store the raw bytes in.
+ * @return 0 Returns a 0 if the payload is malformed.
+ * @return 1 Returns a 1 if the block was decoded.
+ */
+int decompress_block(string &stream, size_t offset, Compressed_block &info, string &block){
+  int n = info.raw_length;
+  string bwt;
+  bwt.reserve(n);
+
+  unsigned char order[256];
+  for(int c = 0; c < 256; c++){
+    order[c] = (unsigned char) c;
+  }
+  vector<unsigned short> tree(1 << BWZ_SYMBOL_BITS, 1 << (RANGE_PROBABILITY_BITS - 1));
+  Range_decoder decoder(stream, offset, offset + info.payload_length);
+  long long zero_run = 0;
+  long long run_weight = 1;
+
+  while(1){
+    int symbol = decoder.decode_symbol(tree);
+    if(symbol == BWZ_RUNA || symbol == BWZ_RUNB){
+      zero_run = zero_run + (symbol == BWZ_RUNA ? run_weight : 2 * run_weight);
+      run_weight = run_weight * 2;
+      if(zero_run > n){
+        return 0;
+      }
+      continue;
+    }
+    if((int) bwt.size() + zero_run > n){
+      return 0;
+    }
+    bwt.append(zero_run, (char) order[0]);
+    zero_run = 0;
+    run_weight = 1;
+    if(symbol == BWZ_EOB){
+      break;
+    }
+    if(symbol > BWZ_EOB || (int) bwt.size() == n){
+      return 0;
+    }
+    int rank = symbol - 1;
+    unsigned char c = order[rank];
+    for(int k = rank; k > 0; k--){
+      order[k] = order[k - 1];
+    }
+    order[0] = c;
+    bwt.push_back((char) c);
+  }
+  if((int) bwt.size() != n || info.primary < 0 || info.primary > n){
+    return 0;
+  }
+
+  // LF over the n + 1 rows. The $ is the smallest character, so row 0 is the
+  // $ suffix and every character bucket starts one row later.
+  vector<int> C(257, 0);
+  for(int i = 0; i < n; i++){
+    C[(unsigned char) bwt[i] + 1]++;
+  }
+  C[0] = 1;
+  for(int c = 1; c < 257; c++){
+    C[c] = C[c] + C[c - 1];
+  }
+  vector<int> LF(n + 1, 0);
+  for(int row = 0; row <= n; row++){
+    if(row == info.primary){
+      continue;
+    }
+    unsigned char c = (unsigned char) bwt[row < info.primary ? row : row - 1];
+    LF[row] = C[c]++;
+  }
+
+  block.resize(n);
+  int row = 0;
+  for(int k = n - 1; k >= 0; k--){
+    if(row == info.primary){
+      return 0;
+    }
+    block[k] = bwt[row < info.primary ? row : row - 1];
+    row = LF[row];
+  }
+  return 1;
+}
+
+/**
+ * void run_block_workers
+ *
+ * Runs job(k) for every block k on thread_count threads. The threads take the
+ * next block number from a shared counter, so large and small blocks even out.
+ *
+ * @param block_count The number of blocks.
+ * @param thread_count The number of threads (1 runs on the calling thread).
+ * @param job The work for one block.
+ */
+void run_block_workers(int block_count, int thread_count, function<void(int)> job){
+  atomic<int> next_block(0);
+  auto worker = [&](){
+    int k;
+    while((k = next_block.fetch_add(1)) < block_count){
+      job(k);
+    }
+  };
+
+  if(thread_count <= 1){
+    worker();
+    return;
+  }
+  vector<thread> threads;
+  for(int t = 0; t < thread_count; t++){
+    threads.push_back(thread(worker));
+  }
+  for(int t = 0; t < thread_count; t++){
+    threads[t].join();
+  }
+}
+
+/**
+ * void bwz_compress
+ *
+ * Compresses data into the block-sorting file format:
+ *
+ *   "BWZ1" block_size
+ *   per block: raw_length crc32 primary payload_length payload
+ *   0
+ *
+ * All numbers are 32-bit little endian, the 0 raw_length ends the file.
+ *
+ * @param data The address to the data.
+ * @param block_size The number of bytes per block.
+ * @param thread_count The number of threads.
+ * @param output The address to store the file in.
+ */
+void bwz_compress(string &data, int block_size, int thread_count, string &output){
+  int block_count = (int) ((data.size() + block_size - 1) / block_size);
+  vector<Compressed_block> blocks(block_count);
+
+  run_block_workers(block_count, thread_count, [&](int k){
+    string block = data.substr((size_t) k * block_size, block_size);
+    compress_block(block, blocks[k]);
+  });
+
+  output = "BWZ1";
+  append_u32(output, block_size);
+  for(int k = 0; k < block_count; k++){
+    append_u32(output, blocks[k].raw_length);
+    append_u32(output, blocks[k].crc);
+    append_u32(output, blocks[k].primary);
+    append_u32(output, blocks[k].payload.size());
+    output.append(blocks[k].payload);
+  }
+  append_u32(output, 0);
+}
+
+/**
+ * int bwz_decompress
+ *
+ * Decompresses a file written by bwz_compress. The headers are read first,
+ * then the blocks are decoded in parallel and each one is checked against
+ * its CRC-32. The block size must be between 1 and BWZ_MAX_BLOCK_SIZE and
+ * no raw_length may exceed it, both are checked before anything is allocated.
+ *
+ * @param stream The address to the compressed file.
+ * @param thread_count The number of threads.
+ * @param output The address to store the data in.
+ * @return -1 Returns an error if the file is malformed or a block is damaged.
+ * @return 0 Finished.
+ */
+int bwz_decompress(string &stream, int thread_count, string &output){
+  size_t offset = 4;
+  unsigned int block_size, raw_length;
+  vector<Compressed_block> blocks;
+  vector<size_t> payload_offsets;
+
+  if(stream.compare(0, 4, "BWZ1") != 0 || !read_u32(stream, offset, block_size)){
+    cerr << "ERROR: not a BWZ1 file." << endl;
+    return -1;
+  }
+  if(block_size < 1 || block_size > BWZ_MAX_BLOCK_SIZE){
+    cerr << "ERROR: BWZ1 block size " << block_size << " is out of range." << endl;
+    return -1;
+  }
+  while(1){
+    if(!read_u32(stream, offset, raw_length)){
+      cerr << "ERROR: BWZ1 file is truncated." << endl;
+      return -1;
+    }
+    if(raw_length == 0){
+      break;
+    }
+    Compressed_block info;
+    unsigned int crc, primary, payload_length;
+    if(raw_length > block_size || !read_u32(stream, offset, crc) ||
+      !read_u32(stream, offset, primary) || !read_u32(stream, offset, payload_length) ||
+      payload_length > stream.size() - offset){
+      cerr << "ERROR: BWZ1 file is truncated." << endl;
+      return -1;
+    }
+    info.raw_length = raw_length;
+    info.crc = crc;
+    info.primary = primary;
+    info.payload_length = payload_length;
+    blocks.push_back(info);
+    payload_offsets.push_back(offset);
+    offset = offset + payload_length;
+  }
+
+  int block_count = (int) blocks.size();
+  vector<string> raw_blocks(block_count);
+  vector<int> block_ok(block_count, 0);
+  run_block_workers(block_count, thread_count, [&](int k){
+    block_ok[k] = decompress_block(stream, payload_offsets[k], blocks[k], raw_blocks[k]) &&
+      crc32(raw_blocks[k].data(), raw_blocks[k].size()) == blocks[k].crc;
+  });
+
+  output.clear();
+  for(int k = 0; k < block_count; k++){
+    if(!block_ok[k]){
+      cerr << "ERROR: block " << k << " checksum mismatch." << endl;
+      return -1;
+    }
+    output.append(raw_blocks[k]);
+  }
+  return 0;
+}
+
+/**
+ * int run_compress_mode
+ *
+ * Handles -compress, -decompress and -compress-bench. The data is read from
+ * stdin as raw bytes (newlines included). Optional arguments are the block
+ * size (not for -decompress) and the number of threads, which defaults to
+ * the number of cores.
+ *
+ * The bench compresses and decompresses the input, checks the round trip and
+ * reports the ratio and both speeds to stderr. It also checks that a header
+ * with an out of range block size and raw length is rejected.
+ *
+ * @param mode The mode.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return -1 Returns an error.
+ * @return 0 Finished.
+ */
+int run_compress_mode(string mode, int argc, char *argv[]){
+  int argument = 2;
+  int block_size = BWZ_DEFAULT_BLOCK_SIZE;
+  int thread_count = (int) thread::hardware_concurrency();
+
+  if(mode != "-decompress" && argc > argument){
+    block_size = atoi(argv[argument++]);
+  }
+  if(argc > argument){
+    thread_count = atoi(argv[argument++]);
+  }
+  if(block_size < 1 || block_size > BWZ_MAX_BLOCK_SIZE){
+    cerr << "ERROR: block size must be between 1 and " << BWZ_MAX_BLOCK_SIZE << "." << endl;
+    return -1;
+  }
+  if(thread_count < 1){
+    thread_count = 1;
+  }
+
+  string input((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+  string output;
+
+  if(mode == "-compress"){
+    bwz_compress(input, block_size, thread_count, output);
+  }
+  else if(mode == "-decompress"){
+    if(bwz_decompress(input, thread_count, output) != 0){
+      return -1;
+    }
+  }
+  else{
+    string restored;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bwz_compress(input, block_size, thread_count, output);
+    double compress_seconds = seconds_since(start);
+    start = chrono::steady_clock::now();
+    int status = bwz_decompress(output, thread_count, restored);
+    double decompress_seconds = seconds_since(start);
+    if(status != 0 || restored != input){
+      cerr << "ERROR: round trip failed." << endl;
+      return -1;
+    }
+
+    // "BWZ1", block_size 0xFFFFFFFF, raw_length 0x90000000, empty payload.
+    string malformed = "BWZ1";
+    append_u32(malformed, 0xFFFFFFFFu);
+    append_u32(malformed, 0x90000000u);
+    append_u32(malformed, 0);
+    append_u32(malformed, 0);
+    append_u32(malformed, 0);
+    append_u32(malformed, 0);
+    ostringstream rejection;
+    streambuf *error_buffer = cerr.rdbuf(rejection.rdbuf());
+    status = bwz_decompress(malformed, thread_count, restored);
+    cerr.rdbuf(error_buffer);
+    if(status == 0){
+      cerr << "ERROR: malformed header was accepted." << endl;
+      return -1;
+    }
+
+    double megabytes = input.size() / 1e6;
+    cerr << "input bytes:      " << input.size() << endl;
+    cerr << "compressed bytes: " << output.size() << endl;
+    cerr << "ratio:            " << (input.empty() ? 0.0 : (double) output.size() / input.size())
+      << " (" << (input.empty() ? 0.0 : 8.0 * output.size() / input.size()) << " bits/byte)" << endl;
+    cerr << "block size:       " << block_size << ", threads: " << thread_count << endl;
+    cerr << "compress:         " << compress_seconds << " s, "
+      << megabytes / compress_seconds << " MB/s" << endl;
+    cerr << "decompress:       " << decompress_seconds << " s, "
+      << megabytes / decompress_seconds << " MB/s" << endl;
+    return 0;
+  }
+
+  cout.write(output.data(), output.size());
+  return 0;
+}
+
+/**
+ * int read_documents
+ *
+ * Reads a document collection from a stream, one document per line. Each
+ * document is stored followed by a '\n', which is its terminator.
+ *
+ * @param input The address to the stream.
+ * @param text The address to store the documents in.
+ * @return The number of documents.
+ */
+int read_documents(istream &input, vector<char> &text){
+  string read_line;
+  int document_count = 0;
+  text.clear();
+  while(getline(input, read_line)){
+    text.insert(text.end(), read_line.begin(), read_line.end());
+    text.push_back('\n');
+    document_count++;
+  }
+  return document_count;
+}
+
+/**
+ * void build_FM_index
+ *
+ * Builds the index of a document collection with run_SAIS. Every terminator
+ * gets its own name, smaller than any character and increasing with the
+ * document number, so two suffixes are never compared past the end of their
+ * documents and equal document suffixes are ordered by document. This is what
+ * makes the index of A.B a merge of the indexes of A and B.
+ *
+ * The names are: 0 for the final $, d for the terminator of document d
+ * (from 1) and document_count + 1 on for the characters, in byte order.
+ *
+ * @param text The address to the documents, each ended by '\n'.
+ * @param document_count The number of documents.
+ * @param index The address to the index.
+ */
+void build_FM_index(vector<char> &text, int document_count, FM_index &index){
+  int size_of_string = (int) text.size() + 1;
+  int recursion_counter = 0;
+  vector<int> T_array(size_of_string);
+  int new_name[256] = {0};
+
+  for(int i = 0; i < size_of_string - 1; i++){
+    new_name[(unsigned char) text[i]] = 1;
+  }
+  int counter_index = document_count + 1;
+  for(int c = 0; c < 256; c++){
+    if(new_name[c] && c != '\n'){
+      new_name[c] = counter_index;
+      counter_index = counter_index + 1;
+    }
+  }
+  int document = 0;
+  for(int i = 0; i < size_of_string - 1; i++){
+    if(text[i] == '\n'){
+      document = document + 1;
+      T_array[i] = document;
+    }
+    else{
+      T_array[i] = new_name[(unsigned char) text[i]];
+    }
+  }
+  T_array[size_of_string - 1] = 0;
+
+  index.text = text;
+  index.document_count = document_count;
+  index.SA.assign(size_of_string, -1);
+  run_SAIS(index.SA, T_array, size_of_string, recursion_counter);
+
+  index.BWT.resize(size_of_string);
+  for(int i = 0; i < size_of_string; i++){
+    index.BWT[i] = (index.SA[i] == 0) ? '\n' : text[index.SA[i] - 1];
+  }
+  prepare_FM_index(index);
+}
+
+/**
+ * void prepare_FM_index
+ *
+ * Fills in the parts of the index that are not saved: C and the occurrence
+ * checkpoints of the BWT, the count of every byte before each multiple of
+ * FM_OCC_SAMPLE_RATE rows. The $ and the terminators all come before the
+ * characters, so C[c] starts after them.
+ *
+ * @param index The address to the index.
+ */
+void prepare_FM_index(FM_index &index){
+  int rows = (int) index.BWT.size();
+  int blocks = rows / FM_OCC_SAMPLE_RATE + 1;
+  vector<int> counts(256, 0);
+
+  index.occ_samples.assign((size_t) blocks * 256, 0);
+  for(int i = 0; i < rows; i++){
+    if(i % FM_OCC_SAMPLE_RATE == 0){
+      copy(counts.begin(), counts.end(),
+        index.occ_samples.begin() + (size_t) (i / FM_OCC_SAMPLE_RATE) * 256);
+    }
+    counts[(unsigned char) index.BWT[i]]++;
+  }
+
+  index.C.assign(257, 0);
+  int smaller = 1 + index.document_count;
+  for(int c = 0; c < 256; c++){
+    index.C[c] = smaller;
+    if(c != '\n'){
+      smaller = smaller + counts[c];
+    }
+  }
+  index.C[256] = smaller;
+}
+
+/**
+ * int fm_occ
+ *
+ * The number of times byte c is in BWT[0..row), from the checkpoint before
+ * row plus a scan of at most FM_OCC_SAMPLE_RATE - 1 bytes.
+ *
+ * @param index The address to the index.
+ * @param c The byte.
+ * @param row The row.
+ * @return The count.
+ */
+int fm_occ(FM_index &index, unsigned char c, int row){
+  int block = row / FM_OCC_SAMPLE_RATE;
+  int count = index.occ_samples[(size_t) block * 256 + c];
+  const char *bwt = index.BWT.data();
+  for(int i = block * FM_OCC_SAMPLE_RATE; i < row; i++){
+    count = count + ((unsigned char) bwt[i] == c);
+  }
+  return count;
+}
+
+/**
+ * void write_FM_index_header
+ *
+ * Writes the start of an index file: the magic and the document count. The
+ * text, SA and BWT arrays follow in write_array form.
+ *
+ * @param file The address to the output file.
+ * @param document_count The number of documents.
+ */
+void write_FM_index_header(ofstream &file, int document_count){
+  file.write("FMI1", 4);
+  file.write((char *) &document_count, sizeof(document_count));
+}
+
+/**
+ * int save_FM_index
+ *
+ * Saves the index (documents, SA and BWT) to a binary file.
+ *
+ * @param index The address to the index.
+ * @param file_name The name of the file.
+ * @return 1 Returns a 1 if the file was written, 0 if not.
+ */
+int save_FM_index(FM_index &index, string file_name){
+  ofstream file(file_name.c_str(), ios::binary);
+  if(!file){
+    return 0;
+  }
+  write_FM_index_header(file, index.document_count);
+  write_array(file, index.text);
+  write_array(file, index.SA);
+  write_array(file, index.BWT);
+  return file ? 1 : 0;
+}
+
+/**
+ * int load_FM_index
+ *
+ * Loads an index saved by save_FM_index and prepares it for searching.
+ *
+ * @param index The address to the index.
+ * @param file_name The name of the file.
+ * @return 1 Returns a 1 if the file was read, 0 if not.
+ */
+int load_FM_index(FM_index &index, string file_name){
+  ifstream file(file_name.c_str(), ios::binary);
+  char magic[4];
+  if(!file || !file.read(magic, 4) || string(magic, 4) != "FMI1"){
+    return 0;
+  }
+  file.read((char *) &index.document_count, sizeof(index.document_count));
+  if(!read_array(file, index.text) || !read_array(file, index.SA) ||
+    !read_array(file, index.BWT) || index.BWT.empty() ||
+    (!index.text.empty() && index.BWT.size() != index.text.size() + 1) ||
+    (!index.SA.empty() && index.SA.size() != index.BWT.size())){
+    return 0;
+  }
+  prepare_FM_index(index);
+  return 1;
+}
+
+/**
+ * void merge_FM_index
+ *
+ * Builds the index of the collection A.B (the documents of A, then those of
+ * B) from the indexes of A and B without sorting again.
+ *
+ * Suffixes of A keep their order and so do suffixes of B, only the way they
+ * interleave is new. For every suffix of B, backward search in A gives how
+ * many rows of A are smaller: a terminator suffix of B comes right after the
+ * $ and the terminators of A, and for c.X the rank is C[c] + occ(c, rank of
+ * X) (an equal document suffix of A is smaller since A's terminators are).
+ * The ranks of B in SA order are the interleave, and one pass over both
+ * arrays writes SA and BWT of A.B. The A $ row and the B $ row are dropped.
+ *
+ * Time is O(|B| FM_OCC_SAMPLE_RATE) for the ranks plus one sequential pass
+ * over both indexes.
+ *
+ * @param A The address to the index of A.
+ * @param B The address to the index of B.
+ * @param merged The address to the index of A.B.
+ */
+void merge_FM_index(FM_index &A, FM_index &B, FM_index &merged){
+  int size_of_A = (int) A.text.size();
+  int size_of_B = (int) B.text.size();
+  vector<int> rank_in_A(size_of_B);
+
+  // Each document of B right to left, starting from its terminator.
+  int end = size_of_B - 1;
+  while(end >= 0){
+    int rank = 1 + A.document_count;
+    rank_in_A[end] = rank;
+    int p = end - 1;
+    while(p >= 0 && B.text[p] != '\n'){
+      unsigned char c = (unsigned char) B.text[p];
+      rank = A.C[c] + fm_occ(A, c, rank);
+      rank_in_A[p] = rank;
+      p = p - 1;
+    }
+    end = p;
+  }
+
+  int rows = size_of_A + size_of_B + 1;
+  merged.document_count = A.document_count + B.document_count;
+  merged.text.resize(size_of_A + size_of_B);
+  copy(A.text.begin(), A.text.end(), merged.text.begin());
+  copy(B.text.begin(), B.text.end(), merged.text.begin() + size_of_A);
+  merged.SA.resize(rows);
+  merged.BWT.resize(rows);
+
+  merged.SA[0] = size_of_A + size_of_B;
+  merged.BWT[0] = '\n';
+  int out = 1;
+  int a_row = 1;
+  for(int b_row = 1; b_row <= size_of_B; b_row++){
+    int position = B.SA[b_row];
+    int rank = rank_in_A[position];
+    while(a_row < rank){
+      merged.SA[out] = A.SA[a_row];
+      merged.BWT[out] = A.BWT[a_row];
+      out++;
+      a_row++;
+    }
+    merged.SA[out] = size_of_A + position;
+    merged.BWT[out] = B.BWT[b_row];
+    out++;
+  }
+  while(a_row <= size_of_A){
+    merged.SA[out] = A.SA[a_row];
+    merged.BWT[out] = A.BWT[a_row];
+    out++;
+    a_row++;
+  }
+  prepare_FM_index(merged);
+}
+
+/**
+ * int run_fm_mode
+ *
+ * Handles the document collection index modes. Documents are the lines of
+ * stdin.
+ *
+ *   -fm-build OUT             Index the documents and save to OUT.
+ *   -fm-merge A B OUT         Merge two saved indexes into OUT.
+ *   -fm-append A OUT          Index the documents, merge them after A.
+ *   -fm-append-bench A        Time -fm-append against indexing A.B from
+ *                             scratch with run_SAIS, and check they agree.
+ *   -fm-count INDEX PATTERNS  Print the number of occurrences of every
+ *                             line of PATTERNS.
+ *   -bcr-build OUT            Build only the BWT, column by column (BCR),
+ *                             for very many short documents.
+ *
+ * @param mode The mode.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return -1 Returns an error.
+ * @return 0 Finished.
+ */
+int run_fm_mode(string mode, int argc, char *argv[]){
+  int needed_arguments = (mode == "-fm-merge") ? 3 :
+    (mode == "-fm-append" || mode == "-fm-count") ? 2 : 1;
+  if(argc < 2 + needed_arguments){
+    cerr << "ERROR: " << mode << " needs " << needed_arguments << " argument(s)." << endl;
+    return -1;
+  }
+
+  FM_index A, B, merged;
+  vector<char> text;
+  int document_count;
+
+  if(mode == "-fm-build"){
+    document_count = read_documents(cin, text);
+    build_FM_index(text, document_count, merged);
+    if(!save_FM_index(merged, argv[2])){
+      cerr << "ERROR: can't write index file <" << argv[2] << ">." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  if(mode == "-bcr-build"){
+    if(!build_BCR(cin, argv[2])){
+      cerr << "ERROR: can't write index file <" << argv[2] << ">." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  if(!load_FM_index(A, argv[2])){
+    cerr << "ERROR: can't read index file <" << argv[2] << ">." << endl;
+    return -1;
+  }
+
+  if(mode == "-fm-count"){
+    vector<string> patterns;
+    int lb, rb;
+    if(!read_lines(argv[3], patterns)){
+      cerr << "ERROR: can't read pattern file <" << argv[3] << ">." << endl;
+      return -1;
+    }
+    for(int k = 0; k < (int) patterns.size(); k++){
+      cout << fm_count(A, patterns[k], lb, rb) << endl;
+    }
+    return 0;
+  }
+
+  if(A.SA.empty()){
+    cerr << "ERROR: index <" << argv[2] << "> has no SA, it can't be merged." << endl;
+    return -1;
+  }
+
+  if(mode == "-fm-merge"){
+    if(!load_FM_index(B, argv[3]) || B.SA.empty()){
+      cerr << "ERROR: can't read index file <" << argv[3] << "> (or it has no SA)." << endl;
+      return -1;
+    }
+    merge_FM_index(A, B, merged);
+    if(!save_FM_index(merged, argv[4])){
+      cerr << "ERROR: can't write index file <" << argv[4] << ">." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  document_count = read_documents(cin, text);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  build_FM_index(text, document_count, B);
+  double build_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  merge_FM_index(A, B, merged);
+  double merge_seconds = seconds_since(start);
+
+  if(mode == "-fm-append"){
+    if(!save_FM_index(merged, argv[3])){
+      cerr << "ERROR: can't write index file <" << argv[3] << ">." << endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  FM_index rebuilt;
+  start = chrono::steady_clock::now();
+  build_FM_index(merged.text, merged.document_count, rebuilt);
+  double rebuild_seconds = seconds_since(start);
+  if(rebuilt.SA != merged.SA || rebuilt.BWT != merged.BWT){
+    cerr << "ERROR: merged index differs from the rebuilt one." << endl;
+    return -1;
+  }
+
+  cerr << "A: " << A.text.size() << " bytes, " << A.document_count << " documents" << endl;
+  cerr << "B: " << B.text.size() << " bytes, " << B.document_count << " documents" << endl;
+  cerr << "index B:        " << build_seconds << " s" << endl;
+  cerr << "merge:          " << merge_seconds << " s" << endl;
+  cerr << "append total:   " << build_seconds + merge_seconds << " s" << endl;
+  cerr << "full rebuild:   " << rebuild_seconds << " s" << endl;
+  cerr << "speedup:        " << rebuild_seconds / (build_seconds + merge_seconds) << "x" << endl;
+  return 0;
+}
+
+/**
+ * int fm_count
+ *
+ * Backward search: the rows [lb..rb) of the suffixes that start with
+ * pattern, one C + occ step per character from the last one.
+ *
+ * @param index The address to the index.
+ * @param pattern The address to the pattern.
+ * @param lb The address to store the first row in.
+ * @param rb The address to store the row after the last one in.
+ * @return The number of occurrences, rb - lb.
+ */
+int fm_count(FM_index &index, string &pattern, int &lb, int &rb){
+  lb = 0;
+  rb = (int) index.BWT.size();
+  for(int k = (int) pattern.size() - 1; k >= 0 && lb < rb; k--){
+    unsigned char c = (unsigned char) pattern[k];
+    if(c == '\n'){
+      lb = rb = 0;
+      break;
+    }
+    lb = index.C[c] + fm_occ(index, c, lb);
+    rb = index.C[c] + fm_occ(index, c, rb);
+  }
+  return rb - lb;
+}
+
+/**
+ * string bcr_file_name
+ *
+ * The name of a temporary file of -bcr-build, next to the output file.
+ *
+ * @param out_file The output file.
+ * @param kind "input", "column" or "bucket".
+ * @param k The column or bucket number.
+ * @return The file name.
+ */
+string bcr_file_name(string out_file, string kind, int k){
+  ostringstream name;
+  name << out_file << ".tmp." << kind << "." << k;
+  return name.str();
+}
+
+/**
+ * void bcr_remove_files
+ *
+ * Removes the temporary files of -bcr-build: the saved input, every bucket
+ * (and a half written ".new" one) and columns [first_column..last_column).
+ *
+ * @param out_file The output file (prefix of the temporary files).
+ * @param first_column The first column that may still be on disk.
+ * @param last_column The column after the last one.
+ */
+void bcr_remove_files(string out_file, int first_column, int last_column){
+  remove(bcr_file_name(out_file, "input", 0).c_str());
+  for(int c = 0; c < 256; c++){
+    string name = bcr_file_name(out_file, "bucket", c);
+    remove(name.c_str());
+    remove((name + ".new").c_str());
+  }
+  for(int k = first_column; k < last_column; k++){
+    remove(bcr_file_name(out_file, "column", k).c_str());
+  }
+}
+
+/**
+ * void bcr_copy_bytes
+ *
+ * Copies count bytes from in to out (out may be null to skip them), adding
+ * every byte to counts if counts is not null.
+ *
+ * @param in The stream to read.
+ * @param out The stream to write, or null.
+ * @param count The number of bytes.
+ * @param counts The 256 byte counters, or null.
+ */
+void bcr_copy_bytes(streambuf *in, streambuf *out, long long count, long long *counts){
+  char buffer[BCR_BUFFER_SIZE];
+  while(count > 0){
+    streamsize chunk = (streamsize) min(count, (long long) BCR_BUFFER_SIZE);
+    chunk = in->sgetn(buffer, chunk);
+    if(chunk <= 0){
+      return;
+    }
+    if(counts){
+      for(streamsize i = 0; i < chunk; i++){
+        counts[(unsigned char) buffer[i]]++;
+      }
+    }
+    if(out){
+      out->sputn(buffer, chunk);
+    }
+    count = count - chunk;
+  }
+}
+
+/**
+ * void bcr_write_columns
+ *
+ * Writes columns [first..last) of the collection to their own files. Column
+ * k holds the k-th character from the end of every string longer than k, in
+ * string order. One pass over the saved input per group of columns keeps the
+ * number of open files at BCR_COLUMNS_PER_PASS.
+ *
+ * @param out_file The output file (prefix of the temporary files).
+ * @param first The first column.
+ * @param last The column after the last one.
+ */
+void bcr_write_columns(string out_file, int first, int last){
+  ifstream input(bcr_file_name(out_file, "input", 0).c_str(), ios::binary);
+  vector<ofstream *> columns;
+  string read_line;
+
+  for(int k = first; k < last; k++){
+    columns.push_back(new ofstream(bcr_file_name(out_file, "column", k).c_str(), ios::binary));
+  }
+  while(getline(input, read_line)){
+    int length = (int) read_line.size();
+    for(int k = first; k < last && k < length; k++){
+      columns[k - first]->put(read_line[length - 1 - k]);
+    }
+  }
+  for(int k = 0; k < (int) columns.size(); k++){
+    delete columns[k];
+  }
+}
+
+/**
+ * void bcr_load_column
+ *
+ * Loads column k into column[j] for every string j longer than k, writing
+ * the next group of column files first if column k is not written yet.
+ *
+ * @param out_file The output file (prefix of the temporary files).
+ * @param lengths The address to the string lengths.
+ * @param max_length The longest string.
+ * @param k The column.
+ * @param column The address to the column, one byte per string.
+ */
+void bcr_load_column(string out_file, vector<int> &lengths, int max_length, int k,
+  vector<char> &column){
+  if(k % BCR_COLUMNS_PER_PASS == 0){
+    bcr_write_columns(out_file, k, min(k + BCR_COLUMNS_PER_PASS, max_length));
+  }
+  string name = bcr_file_name(out_file, "column", k);
+  ifstream file(name.c_str(), ios::binary);
+  streambuf *in = file.rdbuf();
+  for(int j = 0; j < (int) lengths.size(); j++){
+    if(lengths[j] > k){
+      column[j] = (char) in->sbumpc();
+    }
+  }
+  file.close();
+  remove(name.c_str());
+}
+
+/**
+ * int build_BCR
+ *
+ * Builds the BWT of a string collection (one string per line of input)
+ * column by column, the BCR way of Bauer, Cox and Rosone, and saves it as an
+ * FM index without text and SA.
+ *
+ * The partial BWT is kept on disk as one file per first character (bucket,
+ * '\n' for the terminators). Round k inserts the suffix of length k of every
+ * string longer than k - 1: its row in bucket c = S[len - k] is the number
+ * of c's in all rows before the row of the suffix of length k - 1, and its
+ * BWT character is S[len - k - 1] ('\n' once the whole string is in). The
+ * strings are processed in row order, so one streaming pass over the buckets
+ * gives all ranks, and a stable distribution by c gives the row order for
+ * the next round. A second pass rewrites the buckets that get new rows.
+ *
+ * In memory are only a few bytes per string (length, bucket, row, two
+ * column characters and the order), the input is read again one column
+ * group at a time. Terminators are ordered by string number like in
+ * build_FM_index, so both give the same BWT. The temporary files are
+ * removed on every return (see bcr_remove_files).
+ *
+ * @param input The address to the stream with the strings.
+ * @param out_file The index file to write.
+ * @return 0 Returns a 0 if a file can't be written.
+ * @return 1 Finished.
+ */
+int build_BCR(istream &input, string out_file){
+  vector<int> lengths;
+  int max_length = 0;
+  long long total_length = 0;
+  string read_line;
+
+  // Save the input, it is read again for every group of columns.
+  {
+    ofstream saved(bcr_file_name(out_file, "input", 0).c_str(), ios::binary);
+    if(!saved){
+      bcr_remove_files(out_file, 0, 0);
+      return 0;
+    }
+    while(getline(input, read_line)){
+      saved << read_line << '\n';
+      lengths.push_back((int) read_line.size());
+      max_length = max(max_length, (int) read_line.size());
+      total_length = total_length + read_line.size();
+    }
+  }
+
+  int string_count = (int) lengths.size();
+  vector<unsigned char> bucket(string_count, '\n');
+  vector<long long> position(string_count);
+  vector<char> current(string_count, '\n');
+  vector<char> next(string_count, '\n');
+  vector<int> order;
+  vector<int> new_order(string_count);
+  vector<long long> bucket_size(256, 0);
+
+  // Buckets in row order: the terminators, then the characters.
+  vector<int> bucket_order(1, '\n');
+  for(int c = 0; c < 256; c++){
+    if(c != '\n'){
+      bucket_order.push_back(c);
+    }
+  }
+
+  // Round 0: the terminator rows, in string order.
+  if(max_length > 0){
+    bcr_load_column(out_file, lengths, max_length, 0, current);
+  }
+  {
+    ofstream terminators(bcr_file_name(out_file, "bucket", '\n').c_str(), ios::binary);
+    for(int j = 0; j < string_count; j++){
+      terminators.put(lengths[j] > 0 ? current[j] : '\n');
+      position[j] = j;
+      if(lengths[j] > 0){
+        order.push_back(j);
+      }
+    }
+    bucket_size['\n'] = string_count;
+  }
+
+  for(int k = 1; k <= max_length; k++){
+    if(k < max_length){
+      bcr_load_column(out_file, lengths, max_length, k, next);
+    }
+
+    // Pass 1: the new row of every active string, in row order.
+    long long counts[256] = {0};
+    int g = 0;
+    long long read_in_bucket = 0;
+    ifstream old_bucket(bcr_file_name(out_file, "bucket", bucket_order[0]).c_str(),
+      ios::binary);
+    vector<int> inserted(256, 0);
+    for(int t = 0; t < (int) order.size(); t++){
+      int j = order[t];
+      while(bucket_order[g] != bucket[j]){
+        bcr_copy_bytes(old_bucket.rdbuf(), 0, bucket_size[bucket_order[g]] - read_in_bucket,
+          counts);
+        g++;
+        read_in_bucket = 0;
+        old_bucket.close();
+        old_bucket.open(bcr_file_name(out_file, "bucket", bucket_order[g]).c_str(), ios::binary);
+      }
+      bcr_copy_bytes(old_bucket.rdbuf(), 0, position[j] - read_in_bucket, counts);
+      read_in_bucket = position[j];
+      unsigned char c = (unsigned char) current[j];
+      bucket[j] = c;
+      position[j] = counts[c];
+      inserted[c]++;
+    }
+    old_bucket.close();
+
+    // Stable distribution by bucket gives the order of the new rows.
+    vector<int> start(256, 0);
+    int offset = 0;
+    for(int b = 0; b < (int) bucket_order.size(); b++){
+      start[bucket_order[b]] = offset;
+      offset = offset + inserted[bucket_order[b]];
+    }
+    vector<int> fill = start;
+    for(int t = 0; t < (int) order.size(); t++){
+      new_order[fill[bucket[order[t]]]++] = order[t];
+    }
+
+    // Pass 2: rewrite each bucket that gets new rows.
+    for(int b = 0; b < (int) bucket_order.size(); b++){
+      int c = bucket_order[b];
+      if(inserted[c] == 0){
+        continue;
+      }
+      string name = bcr_file_name(out_file, "bucket", c);
+      string new_name = name + ".new";
+      ifstream in(name.c_str(), ios::binary);
+      ofstream out(new_name.c_str(), ios::binary);
+      long long written = 0;
+      for(int t = start[c]; t < start[c] + inserted[c]; t++){
+        int j = new_order[t];
+        bcr_copy_bytes(in.rdbuf(), out.rdbuf(), position[j] - written, 0);
+        out.put(lengths[j] > k ? next[j] : '\n');
+        written = position[j] + 1;
+      }
+      bcr_copy_bytes(in.rdbuf(), out.rdbuf(), bucket_size[c] + inserted[c] - written, 0);
+      in.close();
+      out.close();
+      if(!out || rename(new_name.c_str(), name.c_str()) != 0){
+        bcr_remove_files(out_file, k, min(max_length,
+          (k / BCR_COLUMNS_PER_PASS + 1) * BCR_COLUMNS_PER_PASS));
+        return 0;
+      }
+      bucket_size[c] = bucket_size[c] + inserted[c];
+    }
+
+    // Strings that are now complete drop out.
+    order.clear();
+    for(int t = 0; t < offset; t++){
+      int j = new_order[t];
+      if(lengths[j] > k){
+        current[j] = next[j];
+        order.push_back(j);
+      }
+    }
+  }
+
+  // The index: row 0 for the $, then the buckets in row order.
+  ofstream file(out_file.c_str(), ios::binary);
+  if(!file){
+    bcr_remove_files(out_file, 0, 0);
+    return 0;
+  }
+  vector<char> no_text;
+  vector<int> no_SA;
+  long long rows = total_length + string_count + 1;
+  write_FM_index_header(file, string_count);
+  write_array(file, no_text);
+  write_array(file, no_SA);
+  file.write((char *) &rows, sizeof(rows));
+  file.put('\n');
+  for(int b = 0; b < (int) bucket_order.size(); b++){
+    string name = bcr_file_name(out_file, "bucket", bucket_order[b]);
+    ifstream in(name.c_str(), ios::binary);
+    if(in){
+      bcr_copy_bytes(in.rdbuf(), file.rdbuf(), bucket_size[bucket_order[b]], 0);
+      in.close();
+    }
+  }
+  bcr_remove_files(out_file, 0, 0);
+  return file ? 1 : 0;
+}
+
+/**
+ * void build_rank_bitvector
+ *
+ * Adds the rank directory to a bitvector whose bits are set: the number of
+ * ones before every block of RANK_BLOCK_WORDS words.
+ *
+ * @param bv The address to the bitvector.
+ */
+void build_rank_bitvector(Rank_bitvector &bv){
+  int words = (int) bv.bits.size();
+  bv.block_ranks.assign(words / RANK_BLOCK_WORDS + 2, 0);
+  int ones = 0;
+  for(int w = 0; w < words; w++){
+    if(w % RANK_BLOCK_WORDS == 0){
+      bv.block_ranks[w / RANK_BLOCK_WORDS] = ones;
+    }
+    ones = ones + __builtin_popcountll(bv.bits[w]);
+  }
+  bv.block_ranks[words / RANK_BLOCK_WORDS + 1] = ones;
+  if(words % RANK_BLOCK_WORDS == 0){
+    bv.block_ranks[words / RANK_BLOCK_WORDS] = ones;
+  }
+  bv.ones = ones;
+}
+
+/**
+ * int bv_rank1
+ *
+ * The number of ones in bits [0..i): the block count plus a popcount of
+ * the words after the block start.
+ *
+ * @param bv The address to the bitvector.
+ * @param i The position (0 to size).
+ * @return The count.
+ */
+int bv_rank1(Rank_bitvector &bv, int i){
+  int word = i >> 6;
+  int block = word / RANK_BLOCK_WORDS;
+  int ones = bv.block_ranks[block];
+  for(int w = block * RANK_BLOCK_WORDS; w < word; w++){
+    ones = ones + __builtin_popcountll(bv.bits[w]);
+  }
+  if(i & 63){
+    ones = ones + __builtin_popcountll(bv.bits[word] & ((1ULL << (i & 63)) - 1));
+  }
+  return ones;
+}
+
+/**
+ * int bv_select
+ *
+ * The position of the k-th one (bit = 1) or zero (bit = 0), k from 1.
+ * Binary search over the block counts, then popcounts over the words of
+ * the block, then the bit inside the word.
+ *
+ * @param bv The address to the bitvector.
+ * @param bit Which bit to look for.
+ * @param k Which one of them (must exist).
+ * @return The position.
+ */
+int bv_select(Rank_bitvector &bv, int bit, int k){
+  int low = 0;
+  int high = (int) bv.block_ranks.size() - 1;
+  // Last block with fewer than k of the bit before it.
+  while(high - low > 1){
+    int middle = (low + high) / 2;
+    int before = bit ? bv.block_ranks[middle] :
+      middle * RANK_BLOCK_WORDS * 64 - bv.block_ranks[middle];
+    if(before < k){
+      low = middle;
+    }
+    else{
+      high = middle;
+    }
+  }
+  int w = low * RANK_BLOCK_WORDS;
+  k = k - (bit ? bv.block_ranks[low] : w * 64 - bv.block_ranks[low]);
+  while(1){
+    unsigned long long word = bit ? bv.bits[w] : ~bv.bits[w];
+    int count = __builtin_popcountll(word);
+    if(count >= k){
+      for(int r = 1; r < k; r++){
+        word = word & (word - 1);
+      }
+      return w * 64 + __builtin_ctzll(word);
+    }
+    k = k - count;
+    w++;
+  }
+}
+
+/**
+ * void build_wavelet_matrix
+ *
+ * Builds the wavelet matrix of a sequence of symbols in [0..sigma). Level l
+ * (from the highest bit down) holds bit l of every symbol in the order the
+ * level above left them: a stable partition with the zeros first.
+ *
+ * @param sequence The address to the sequence.
+ * @param sigma The alphabet size.
+ * @param wm The address to the wavelet matrix.
+ */
+void build_wavelet_matrix(vector<int> &sequence, int sigma, Wavelet_matrix &wm){
+  int n = (int) sequence.size();
+  vector<int> current = sequence;
+  vector<int> next(n);
+
+  wm.size = n;
+  wm.levels = 1;
+  while((1LL << wm.levels) < sigma){
+    wm.levels++;
+  }
+  wm.bitvectors.assign(wm.levels, Rank_bitvector());
+  wm.zeros.assign(wm.levels, 0);
+
+  for(int level = 0; level < wm.levels; level++){
+    int shift = wm.levels - 1 - level;
+    Rank_bitvector &bv = wm.bitvectors[level];
+    bv.bits.assign(n / 64 + 1, 0);
+    int zeros = 0;
+    for(int i = 0; i < n; i++){
+      if((current[i] >> shift) & 1){
+        bv.bits[i >> 6] |= 1ULL << (i & 63);
+      }
+      else{
+        next[zeros++] = current[i];
+      }
+    }
+    wm.zeros[level] = zeros;
+    int ones = zeros;
+    for(int i = 0; i < n; i++){
+      if((current[i] >> shift) & 1){
+        next[ones++] = current[i];
+      }
+    }
+    build_rank_bitvector(bv);
+    current.swap(next);
+  }
+}
+
+/**
+ * int wm_access
+ *
+ * The symbol at position i.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @param i The position.
+ * @return The symbol.
+ */
+int wm_access(Wavelet_matrix &wm, int i){
+  int symbol = 0;
+  for(int level = 0; level < wm.levels; level++){
+    Rank_bitvector &bv = wm.bitvectors[level];
+    int bit = (bv.bits[i >> 6] >> (i & 63)) & 1;
+    int ones = bv_rank1(bv, i);
+    i = bit ? wm.zeros[level] + ones : i - ones;
+    symbol = (symbol << 1) | bit;
+  }
+  return symbol;
+}
+
+/**
+ * int wm_rank
+ *
+ * The number of times symbol c occurs in [0..i). Follows c down the levels
+ * with the positions 0 and i, the answer is the width of the range at the
+ * bottom.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @param c The symbol.
+ * @param i The position (0 to size).
+ * @return The count.
+ */
+int wm_rank(Wavelet_matrix &wm, int c, int i){
+  int start = 0;
+  for(int level = 0; level < wm.levels; level++){
+    Rank_bitvector &bv = wm.bitvectors[level];
+    if((c >> (wm.levels - 1 - level)) & 1){
+      start = wm.zeros[level] + bv_rank1(bv, start);
+      i = wm.zeros[level] + bv_rank1(bv, i);
+    }
+    else{
+      start = start - bv_rank1(bv, start);
+      i = i - bv_rank1(bv, i);
+    }
+  }
+  return i - start;
+}
+
+/**
+ * int wm_select
+ *
+ * The position of the k-th occurrence of symbol c (k from 1). Goes down to
+ * where c starts at the bottom, then back up with select on every level.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @param c The symbol.
+ * @param k Which occurrence (must exist).
+ * @return The position.
+ */
+int wm_select(Wavelet_matrix &wm, int c, int k){
+  vector<int> starts(wm.levels + 1, 0);
+  for(int level = 0; level < wm.levels; level++){
+    Rank_bitvector &bv = wm.bitvectors[level];
+    int start = starts[level];
+    if((c >> (wm.levels - 1 - level)) & 1){
+      starts[level + 1] = wm.zeros[level] + bv_rank1(bv, start);
+    }
+    else{
+      starts[level + 1] = start - bv_rank1(bv, start);
+    }
+  }
+  int p = starts[wm.levels] + k - 1;
+  for(int level = wm.levels - 1; level >= 0; level--){
+    if((c >> (wm.levels - 1 - level)) & 1){
+      p = bv_select(wm.bitvectors[level], 1, p - wm.zeros[level] + 1);
+    }
+    else{
+      p = bv_select(wm.bitvectors[level], 0, p + 1);
+    }
+  }
+  return p;
+}
+
+/**
+ * long long wm_size_in_bits
+ *
+ * The space of the wavelet matrix: bits and rank directories.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @return The size in bits.
+ */
+long long wm_size_in_bits(Wavelet_matrix &wm){
+  long long bits = 0;
+  for(int level = 0; level < wm.levels; level++){
+    bits = bits + 64LL * wm.bitvectors[level].bits.size() +
+      32LL * wm.bitvectors[level].block_ranks.size();
+  }
+  return bits;
+}
+
+/**
+ * int wm_backward_search
+ *
+ * Backward search over a BWT held in a wavelet matrix: the rows [lb..rb) of
+ * the suffixes starting with pattern. C[c] is the first row starting with c.
+ *
+ * @param wm The address to the wavelet matrix of the BWT.
+ * @param C The address to C, one entry per symbol plus one.
+ * @param pattern The address to the pattern (symbols).
+ * @param lb The address to store the first row in.
+ * @param rb The address to store the row after the last one in.
+ * @return The number of occurrences.
+ */
+int wm_backward_search(Wavelet_matrix &wm, vector<int> &C, vector<int> &pattern,
+  int &lb, int &rb){
+  int sigma = (int) C.size() - 1;
+  lb = 0;
+  rb = wm.size;
+  for(int k = (int) pattern.size() - 1; k >= 0 && lb < rb; k--){
+    int c = pattern[k];
+    if(c <= 0 || c >= sigma){
+      lb = rb = 0;
+      break;
+    }
+    lb = C[c] + wm_rank(wm, c, lb);
+    rb = C[c] + wm_rank(wm, c, rb);
+  }
+  return rb - lb;
+}
+
+/**
+ * void bwt_symbols_and_C
+ *
+ * The BWT of a named text as a symbol sequence (0 in the row of suffix 0,
+ * where the $ would go) and its C array.
+ *
+ * @param SA_array The address to the SA array.
+ * @param T_array The address to the named text, $ = 0 at the end.
+ * @param sigma The number of names.
+ * @param BWT The address to store the BWT in.
+ * @param C The address to store C in (sigma + 1 entries).
+ */
+void bwt_symbols_and_C(vector<int> &SA_array, vector<int> &T_array, int sigma,
+  vector<int> &BWT, vector<int> &C){
+  int n = (int) SA_array.size();
+  BWT.resize(n);
+  C.assign(sigma + 1, 0);
+  for(int i = 0; i < n; i++){
+    BWT[i] = (SA_array[i] == 0) ? 0 : T_array[SA_array[i] - 1];
+    C[T_array[i] + 1]++;
+  }
+  for(int c = 1; c <= sigma; c++){
+    C[c] = C[c] + C[c - 1];
+  }
+}
+
+/**
+ * bool parse_token
+ *
+ * Parses one token: a decimal number from 0 to 2^64 - 1, nothing else.
+ *
+ * @param word The token.
+ * @param value The address to its value.
+ * @return Whether the whole word is such a number.
+ */
+bool parse_token(string &word, unsigned long long &value){
+  if(word.empty() || word[0] < '0' || word[0] > '9'){
+    return false;
+  }
+  char *end;
+  errno = 0;
+  value = strtoull(word.c_str(), &end, 10);
+  return errno == 0 && *end == '\0';
+}
+
+/**
+ * int run_tokens_mode
+ *
+ * The text is a sequence of integer tokens (whitespace separated, any
+ * unsigned 64-bit values) read from stdin. Tokens are renamed 1.. in
+ * increasing order, SAIS runs on the names, and every line of the pattern
+ * file (tokens too) is counted by backward search on the wavelet matrix of
+ * the BWT. The occurrence tables of the byte modes would need a counter per
+ * token per sample row, the wavelet matrix needs about log(sigma) bits per
+ * token.
+ *
+ * @param pattern_file The file with one pattern per line.
+ * @return -1 Returns an error if the pattern file can't be read or a token
+ *         of the text or of a pattern is not such a number.
+ * @return 0 Finished.
+ */
+int run_tokens_mode(string pattern_file){
+  vector<unsigned long long> tokens;
+  vector<string> patterns;
+  unsigned long long token;
+  string word;
+  int recursion_counter = 0;
+
+  while(cin >> word){
+    if(!parse_token(word, token)){
+      cerr << "ERROR: bad token <" << word << "> in the text." << endl;
+      return -1;
+    }
+    tokens.push_back(token);
+  }
+  if(!cin.eof()){
+    cerr << "ERROR: can't read the text." << endl;
+    return -1;
+  }
+  if(!read_lines(pattern_file, patterns)){
+    cerr << "ERROR: can't read pattern file <" << pattern_file << ">." << endl;
+    return -1;
+  }
+
+  vector<unsigned long long> alphabet = tokens;
+  sort(alphabet.begin(), alphabet.end());
+  alphabet.erase(unique(alphabet.begin(), alphabet.end()), alphabet.end());
+  int sigma = (int) alphabet.size() + 1;
+
+  int size_of_string = (int) tokens.size() + 1;
+  vector<int> T_array(size_of_string, 0);
+  for(int i = 0; i < size_of_string - 1; i++){
+    T_array[i] = 1 + (int) (lower_bound(alphabet.begin(), alphabet.end(), tokens[i]) -
+      alphabet.begin());
+  }
+  vector<int> SA_array(size_of_string, -1);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+  double sais_seconds = seconds_since(start);
+
+  vector<int> BWT, C;
+  Wavelet_matrix wm;
+  start = chrono::steady_clock::now();
+  bwt_symbols_and_C(SA_array, T_array, sigma, BWT, C);
+  build_wavelet_matrix(BWT, sigma, wm);
+  double build_seconds = seconds_since(start);
+
+  // All patterns are checked before the first count is printed.
+  vector<vector<int> > symbol_patterns(patterns.size());
+  for(int k = 0; k < (int) patterns.size(); k++){
+    istringstream line(patterns[k]);
+    while(line >> word){
+      if(!parse_token(word, token)){
+        cerr << "ERROR: bad token <" << word << "> in pattern " << k + 1 << "." << endl;
+        return -1;
+      }
+      vector<unsigned long long>::iterator found = lower_bound(alphabet.begin(),
+        alphabet.end(), token);
+      symbol_patterns[k].push_back((found != alphabet.end() && *found == token) ?
+        1 + (int) (found - alphabet.begin()) : -1);
+    }
+    if(!line.eof()){
+      cerr << "ERROR: can't read pattern " << k + 1 << "." << endl;
+      return -1;
+    }
+  }
+
+  int lb, rb;
+  for(int k = 0; k < (int) patterns.size(); k++){
+    cout << wm_backward_search(wm, C, symbol_patterns[k], lb, rb) << endl;
+  }
+
+  if(DEBUG){
+    cerr << "tokens: " << tokens.size() << ", sigma: " << sigma << ", SAIS: "
+      << sais_seconds << " s, wavelet matrix: " << build_seconds << " s, "
+      << (double) wm_size_in_bits(wm) / size_of_string << " bits per token" << endl;
+  }
+  return 0;
+}
+
+/**
+ * int run_wm_bench
+ *
+ * Counts every line of the pattern file with backward search twice, once
+ * with the byte occurrence tables of the FM index and once with a wavelet
+ * matrix over the same BWT, and reports space and time per query of both.
+ * Also checks access and select of the wavelet matrix at random positions.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param pattern_file The file with one pattern per line.
+ * @return -1 Returns an error if the pattern file can't be read or the two
+ *         backends disagree.
+ * @return 0 Finished.
+ */
+int run_wm_bench(vector<int> &SA_array, string &inputted_string, string pattern_file){
+  vector<string> patterns;
+  if(!read_lines(pattern_file, patterns)){
+    cerr << "ERROR: can't read pattern file <" << pattern_file << ">." << endl;
+    return -1;
+  }
+  int n = (int) SA_array.size();
+
+  // Byte backend: the FM index of a single document-less text.
+  FM_index index;
+  index.document_count = 0;
+  index.SA = SA_array;
+  index.BWT.resize(n);
+  for(int i = 0; i < n; i++){
+    index.BWT[i] = (SA_array[i] == 0) ? '\n' : inputted_string[SA_array[i] - 1];
+  }
+  prepare_FM_index(index);
+
+  // Wavelet matrix backend over byte + 1, 0 for the row of suffix 0.
+  vector<int> T_array(n, 0);
+  for(int i = 0; i < n - 1; i++){
+    T_array[i] = (unsigned char) inputted_string[i] + 1;
+  }
+  vector<int> BWT, C;
+  Wavelet_matrix wm;
+  bwt_symbols_and_C(SA_array, T_array, 257, BWT, C);
+  build_wavelet_matrix(BWT, 257, wm);
+
+  vector<vector<int> > symbol_patterns(patterns.size());
+  for(int k = 0; k < (int) patterns.size(); k++){
+    for(int p = 0; p < (int) patterns[k].size(); p++){
+      symbol_patterns[k].push_back((unsigned char) patterns[k][p] + 1);
+    }
+  }
+
+  int lb, rb;
+  long long table_total = 0;
+  long long wm_total = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for(int k = 0; k < (int) patterns.size(); k++){
+    table_total = table_total + fm_count(index, patterns[k], lb, rb);
+  }
+  double table_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  for(int k = 0; k < (int) patterns.size(); k++){
+    wm_total = wm_total + wm_backward_search(wm, C, symbol_patterns[k], lb, rb);
+  }
+  double wm_seconds = seconds_since(start);
+
+  if(table_total != wm_total){
+    cerr << "ERROR: occurrence tables found " << table_total << " occurrences, wavelet "
+      << "matrix found " << wm_total << "." << endl;
+    return -1;
+  }
+  srand(1);
+  for(int t = 0; t < 1000 && n > 1; t++){
+    int i = rand() % n;
+    int c = wm_access(wm, i);
+    if(c != BWT[i] || wm_select(wm, c, wm_rank(wm, c, i) + 1) != i){
+      cerr << "ERROR: wavelet matrix access/select is wrong at " << i << "." << endl;
+      return -1;
+    }
+  }
+
+  double queries = max((int) patterns.size(), 1);
+  long long table_bits = 32LL * index.occ_samples.size() + 8LL * index.BWT.size();
+  cerr << "text: " << inputted_string.size() << " bytes, " << patterns.size()
+    << " patterns, " << table_total << " occurrences" << endl;
+  cerr << "occurrence tables: " << (double) table_bits / n << " bits/char, "
+    << 1e6 * table_seconds / queries << " us/query" << endl;
+  cerr << "wavelet matrix:    " << (double) wm_size_in_bits(wm) / n << " bits/char, "
+    << 1e6 * wm_seconds / queries << " us/query" << endl;
+  cerr << "occurrence tables for a " << wm.levels << "-bit alphabet would need "
+    << (32.0 * (1 << wm.levels)) / FM_OCC_SAMPLE_RATE << " bits/char" << endl;
+  return 0;
+}
+
+/**
+ * void wm_range_count
+ *
+ * For symbol c and the range [i..j): the rank of c before i, the count of c
+ * in the range and the count of symbols smaller than c in the range, in one
+ * walk down the levels. Where c has a 1 bit, the zeros of the range are the
+ * smaller symbols.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @param c The symbol.
+ * @param i The first position.
+ * @param j The position after the last one.
+ * @param rank The address to store the rank of c before i in.
+ * @param count The address to store the count of c in [i..j) in.
+ * @param less The address to store the count of symbols < c in [i..j) in.
+ */
+void wm_range_count(Wavelet_matrix &wm, int c, int i, int j, int &rank, int &count,
+  int &less){
+  int start = 0;
+  less = 0;
+  for(int level = 0; level < wm.levels; level++){
+    Rank_bitvector &bv = wm.bitvectors[level];
+    int ones_start = bv_rank1(bv, start);
+    int ones_i = bv_rank1(bv, i);
+    int ones_j = bv_rank1(bv, j);
+    if((c >> (wm.levels - 1 - level)) & 1){
+      less = less + (j - i) - (ones_j - ones_i);
+      start = wm.zeros[level] + ones_start;
+      i = wm.zeros[level] + ones_i;
+      j = wm.zeros[level] + ones_j;
+    }
+    else{
+      start = start - ones_start;
+      i = i - ones_i;
+      j = j - ones_j;
+    }
+  }
+  rank = i - start;
+  count = j - i;
+}
+
+/**
+ * void wm_distinct_symbols
+ *
+ * Appends every distinct symbol of [i..j) to symbols, in increasing order,
+ * by following only the non-empty halves of the range on each level.
+ *
+ * @param wm The address to the wavelet matrix.
+ * @param level The level (0 for the whole matrix).
+ * @param i The first position on this level.
+ * @param j The position after the last one on this level.
+ * @param prefix The bits of the symbol above this level.
+ * @param symbols The address to the list of symbols.
+ */
+void wm_distinct_symbols(Wavelet_matrix &wm, int level, int i, int j, int prefix,
+  vector<int> &symbols){
+  if(i >= j){
+    return;
+  }
+  if(level == wm.levels){
+    symbols.push_back(prefix);
+    return;
+  }
+  Rank_bitvector &bv = wm.bitvectors[level];
+  int ones_i = bv_rank1(bv, i);
+  int ones_j = bv_rank1(bv, j);
+  wm_distinct_symbols(wm, level + 1, i - ones_i, j - ones_j, prefix << 1, symbols);
+  wm_distinct_symbols(wm, level + 1, wm.zeros[level] + ones_i, wm.zeros[level] + ones_j,
+    (prefix << 1) | 1, symbols);
+}
+
+/**
+ * void build_bidirectional_index
+ *
+ * Suffix arrays of T and of reverse(T) with run_SAIS on two threads, then a
+ * wavelet matrix over each BWT. The bytes of T are named 1.. in order with
+ * no gaps, as in assign_index_to_T (run_SAIS relies on that), 0 is the $.
+ *
+ * @param text The address to the text.
+ * @param index The address to the index.
+ */
+void build_bidirectional_index(string &text, Bidirectional_index &index){
+  int size_of_string = (int) text.size() + 1;
+  vector<int> T_array(size_of_string, 0);
+  vector<int> T_reverse(size_of_string, 0);
+  vector<int> SA_reverse(size_of_string, -1);
+  for(int c = 0; c < 256; c++){
+    index.name[c] = 0;
+  }
+  for(int i = 0; i < size_of_string - 1; i++){
+    index.name[(unsigned char) text[i]] = 1;
+  }
+  index.sigma = 1;
+  for(int c = 0; c < 256; c++){
+    if(index.name[c]){
+      index.name[c] = index.sigma++;
+    }
+  }
+  for(int i = 0; i < size_of_string - 1; i++){
+    T_array[i] = index.name[(unsigned char) text[i]];
+    T_reverse[size_of_string - 2 - i] = T_array[i];
+  }
+
+  index.SA.assign(size_of_string, -1);
+  thread reverse_sort([&](){
+    int recursion_counter = 0;
+    run_SAIS(SA_reverse, T_reverse, size_of_string, recursion_counter);
+  });
+  int recursion_counter = 0;
+  run_SAIS(index.SA, T_array, size_of_string, recursion_counter);
+  reverse_sort.join();
+
+  vector<int> BWT, C;
+  bwt_symbols_and_C(index.SA, T_array, index.sigma, BWT, index.C);
+  build_wavelet_matrix(BWT, index.sigma, index.forward);
+  bwt_symbols_and_C(SA_reverse, T_reverse, index.sigma, BWT, C);
+  build_wavelet_matrix(BWT, index.sigma, index.reverse);
+}
+
+/**
+ * int bi_extend
+ *
+ * Extends the string of a bi-interval by symbol c on the left (direction 0,
+ * backward search on T) or on the right (direction 1, backward search on
+ * reverse(T)). The interval in the other index moves by the number of
+ * smaller symbols in the range.
+ *
+ * @param index The address to the index.
+ * @param in The address to the bi-interval.
+ * @param c The symbol.
+ * @param direction 0 for left, 1 for right.
+ * @param out The address to the extended bi-interval.
+ * @return The size of the extended bi-interval.
+ */
+int bi_extend(Bidirectional_index &index, Bi_interval &in, int c, int direction,
+  Bi_interval &out){
+  int rank, less;
+  if(direction == 0){
+    wm_range_count(index.forward, c, in.forward, in.forward + in.size, rank, out.size, less);
+    out.forward = index.C[c] + rank;
+    out.reverse = in.reverse + less;
+  }
+  else{
+    wm_range_count(index.reverse, c, in.reverse, in.reverse + in.size, rank, out.size, less);
+    out.reverse = index.C[c] + rank;
+    out.forward = in.forward + less;
+  }
+  return out.size;
+}
+
+/**
+ * void get_search_scheme
+ *
+ * The search scheme for k errors: the pattern is cut into parts, and every
+ * search matches the parts in its order (each one next to the ones already
+ * matched) with the error count after the t-th part in [L[t]..U[t]]. Every
+ * way to spread at most k errors over the parts is allowed by one search.
+ * For k = 1 and 2 these are the schemes of Kucherov, Salikhov and Tsur,
+ * for larger k the pigeonhole scheme (one part without errors, k + 1 parts).
+ *
+ * @param k The number of errors.
+ * @param parts The address to store the number of parts in.
+ * @param searches The address to the searches.
+ */
+void get_search_scheme(int k, int &parts, vector<Search> &searches){
+  searches.clear();
+  if(k == 1){
+    parts = 2;
+    searches.push_back(Search{{0, 1}, {0, 0}, {0, 1}});
+    searches.push_back(Search{{1, 0}, {0, 0}, {0, 1}});
+    return;
+  }
+  if(k == 2){
+    parts = 3;
+    searches.push_back(Search{{0, 1, 2}, {0, 0, 0}, {0, 2, 2}});
+    searches.push_back(Search{{2, 1, 0}, {0, 0, 0}, {0, 1, 2}});
+    searches.push_back(Search{{1, 0, 2}, {0, 1, 1}, {0, 1, 2}});
+    return;
+  }
+  parts = k + 1;
+  for(int seed = 0; seed < parts; seed++){
+    Search search;
+    for(int q = seed; q < parts; q++){
+      search.order.push_back(q);
+    }
+    for(int q = seed - 1; q >= 0; q--){
+      search.order.push_back(q);
+    }
+    search.L.assign(parts, 0);
+    search.U.assign(parts, k);
+    search.U[0] = 0;
+    searches.push_back(search);
+  }
+}
+
+/**
+ * void approx_step
+ *
+ * One step of a search: the pattern range [lo..hi) is matched to the string
+ * of the bi-interval with errors errors, and the t-th part of the search is
+ * being extended (to the right if it lies right of [lo..hi), else to the
+ * left). Tries the pattern character, every other symbol in the range as a
+ * mismatch and, for edit distance, a deletion (a text symbol with no
+ * pattern character) and an insertion (a pattern character with no text
+ * symbol). When a part is done its bounds are checked, after the last part
+ * the text positions of the interval are reported.
+ *
+ * @param search The address to the approximate search.
+ * @param t The step of the search.
+ * @param lo The first matched pattern position.
+ * @param hi The position after the last matched one.
+ * @param interval The bi-interval of the matched text.
+ * @param errors The errors so far.
+ */
+void approx_step(Approx_search &search, int t, int lo, int hi, Bi_interval interval,
+  int errors){
+  Search &scheme = search.searches[search.current];
+  int part = scheme.order[t];
+  int upper = scheme.U[t];
+  int first = search.part_start[part];
+  int last = search.part_start[part + 1];
+  Bi_interval next;
+
+  if(errors > upper || interval.size == 0){
+    return;
+  }
+  // Parts are matched next to the ones before, so a part left of any of
+  // them is extended to the left.
+  int direction = 1;
+  for(int u = 0; u < t; u++){
+    if(scheme.order[u] > part){
+      direction = 0;
+    }
+  }
+
+  bool done = (direction == 1) ? (hi == last) : (lo == first);
+  if(done){
+    if(errors >= scheme.L[t]){
+      if(t + 1 == (int) scheme.order.size()){
+        // Skip the $ suffix, it is only there when all the pattern was
+        // inserted.
+        for(int row = interval.forward; row < interval.forward + interval.size; row++){
+          if(search.index->SA[row] < search.index->forward.size - 1){
+            search.positions.push_back(search.index->SA[row]);
+          }
+        }
+      }
+      else{
+        approx_step(search, t + 1, lo, hi, interval, errors);
+      }
+    }
+    // Text symbols after the part that the pattern doesn't have.
+    if(search.edit && errors < upper){
+      vector<int> symbols;
+      Wavelet_matrix &wm = direction ? search.index->reverse : search.index->forward;
+      int start = direction ? interval.reverse : interval.forward;
+      wm_distinct_symbols(wm, 0, start, start + interval.size, 0, symbols);
+      for(int s = 0; s < (int) symbols.size(); s++){
+        if(symbols[s] != 0 && bi_extend(*search.index, interval, symbols[s], direction, next)){
+          approx_step(search, t, lo, hi, next, errors + 1);
+        }
+      }
+    }
+    return;
+  }
+
+  // A byte that is not in T is named 0, it matches no symbol.
+  int p = search.index->name[(unsigned char) search.pattern[direction ? hi : lo - 1]];
+  int new_lo = direction ? lo : lo - 1;
+  int new_hi = direction ? hi + 1 : hi;
+
+  if(errors == upper){
+    if(p != 0 && bi_extend(*search.index, interval, p, direction, next)){
+      approx_step(search, t, new_lo, new_hi, next, errors);
+    }
+    return;
+  }
+
+  vector<int> symbols;
+  Wavelet_matrix &wm = direction ? search.index->reverse : search.index->forward;
+  int start = direction ? interval.reverse : interval.forward;
+  wm_distinct_symbols(wm, 0, start, start + interval.size, 0, symbols);
+  for(int s = 0; s < (int) symbols.size(); s++){
+    int c = symbols[s];
+    if(c == 0 || !bi_extend(*search.index, interval, c, direction, next)){
+      continue;
+    }
+    approx_step(search, t, new_lo, new_hi, next, errors + (c != p));
+    if(search.edit){
+      approx_step(search, t, lo, hi, next, errors + 1);
+    }
+  }
+  if(search.edit){
+    approx_step(search, t, new_lo, new_hi, interval, errors + 1);
+  }
+}
+
+/**
+ * void approx_find
+ *
+ * All text positions where pattern occurs with at most k mismatches (or,
+ * with edit, where a substring within edit distance k of the pattern
+ * starts), sorted and without repeats.
+ *
+ * @param index The address to the index.
+ * @param pattern The address to the pattern.
+ * @param k The number of errors.
+ * @param edit Whether insertions and deletions count as errors too.
+ * @param positions The address to store the positions in.
+ */
+void approx_find(Bidirectional_index &index, string &pattern, int k, bool edit,
+  vector<int> &positions){
+  Approx_search search;
+  int parts;
+  search.index = &index;
+  search.pattern = pattern;
+  search.edit = edit;
+  get_search_scheme(k, parts, search.searches);
+
+  int m = (int) pattern.size();
+  for(int q = 0; q <= parts; q++){
+    search.part_start.push_back((int) ((long long) m * q / parts));
+  }
+
+  Bi_interval whole;
+  whole.forward = 0;
+  whole.reverse = 0;
+  whole.size = index.forward.size;
+  for(search.current = 0; search.current < (int) search.searches.size(); search.current++){
+    int first = search.part_start[search.searches[search.current].order[0]];
+    approx_step(search, 0, first, first, whole, 0);
+  }
+
+  positions.swap(search.positions);
+  sort(positions.begin(), positions.end());
+  positions.erase(unique(positions.begin(), positions.end()), positions.end());
+}
+
+/**
+ * int brute_force_mismatch_count
+ *
+ * The scan the index replaces: compares the pattern at every text position,
+ * stopping once more than k characters differ.
+ *
+ * @param text The address to the text.
+ * @param pattern The address to the pattern.
+ * @param k The number of mismatches.
+ * @return The number of positions with at most k mismatches.
+ */
+int brute_force_mismatch_count(string &text, string &pattern, int k){
+  int n = (int) text.size();
+  int m = (int) pattern.size();
+  int count = 0;
+  for(int s = 0; s + m <= n; s++){
+    int mismatches = 0;
+    for(int p = 0; p < m && mismatches <= k; p++){
+      mismatches = mismatches + (text[s + p] != pattern[p]);
+    }
+    count = count + (mismatches <= k);
+  }
+  return count;
+}
+
+/**
+ * int run_approx_mode
+ *
+ * -approx K PATTERNS and -approx-edit K PATTERNS print the number of
+ * approximate occurrences of every pattern line. -approx-bench PATTERNS
+ * times the k-mismatch search against the brute force scan (which must give
+ * the same counts) and the k-edit search, for k = 1 and 2. It first checks a
+ * text of 100 c's (one symbol besides the $) for k = 0..2.
+ *
+ * @param inputted_string The address to the text.
+ * @param mode The mode.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return -1 Returns an error.
+ * @return 0 Finished.
+ */
+int run_approx_mode(string &inputted_string, string mode, int argc, char *argv[]){
+  bool bench = (mode == "-approx-bench");
+  string pattern_file = bench ? argv[2] : argv[3];
+  int k = bench ? 1 : atoi(argv[2]);
+  vector<string> patterns;
+  vector<int> positions;
+
+  if(k < 0 || (!bench && argc < 4)){
+    cerr << "ERROR: " << mode << " needs K and a pattern file." << endl;
+    return -1;
+  }
+  if(!read_lines(pattern_file, patterns)){
+    cerr << "ERROR: can't read pattern file <" << pattern_file << ">." << endl;
+    return -1;
+  }
+
+  Bidirectional_index index;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  build_bidirectional_index(inputted_string, index);
+  double build_seconds = seconds_since(start);
+
+  if(!bench){
+    for(int q = 0; q < (int) patterns.size(); q++){
+      approx_find(index, patterns[q], k, mode == "-approx-edit", positions);
+      cout << positions.size() << endl;
+    }
+    return 0;
+  }
+
+  Bidirectional_index repeated_index;
+  string repeated(100, 'c');
+  string repeated_pattern = "c";
+  build_bidirectional_index(repeated, repeated_index);
+  for(k = 0; k <= 2; k++){
+    approx_find(repeated_index, repeated_pattern, k, false, positions);
+    if((int) positions.size() != brute_force_mismatch_count(repeated, repeated_pattern, k)){
+      cerr << "ERROR: k = " << k << ": index found " << positions.size()
+        << " occurrences of \"c\" in 100 c's." << endl;
+      return -1;
+    }
+  }
+
+  double queries = max((int) patterns.size(), 1);
+  cerr << "text: " << inputted_string.size() << " bytes, " << patterns.size()
+    << " patterns, both indexes built in " << build_seconds << " s" << endl;
+  for(k = 1; k <= 2; k++){
+    long long index_total = 0;
+    long long scan_total = 0;
+    long long edit_total = 0;
+    start = chrono::steady_clock::now();
+    for(int q = 0; q < (int) patterns.size(); q++){
+      approx_find(index, patterns[q], k, false, positions);
+      index_total = index_total + positions.size();
+    }
+    double index_seconds = seconds_since(start);
+    start = chrono::steady_clock::now();
+    for(int q = 0; q < (int) patterns.size(); q++){
+      scan_total = scan_total + brute_force_mismatch_count(inputted_string, patterns[q], k);
+    }
+    double scan_seconds = seconds_since(start);
+    start = chrono::steady_clock::now();
+    for(int q = 0; q < (int) patterns.size(); q++){
+      approx_find(index, patterns[q], k, true, positions);
+      edit_total = edit_total + positions.size();
+    }
+    double edit_seconds = seconds_since(start);
+
+    if(index_total != scan_total){
+      cerr << "ERROR: k = " << k << ": index found " << index_total << " occurrences, scan found "
+        << scan_total << "." << endl;
+      return -1;
+    }
+    cerr << "k = " << k << " mismatches: " << index_total << " occurrences, index "
+      << queries / index_seconds << " queries/s, scan " << queries / scan_seconds
+      << " queries/s" << endl;
+    cerr << "k = " << k << " edits:      " << edit_total << " occurrences, index "
+      << queries / edit_seconds << " queries/s" << endl;
+  }
+  return 0;
+}
+
+/**
+ * void build_LCE
+ *
+ * Builds the LCE structure: ISA, LCP and a range minimum structure over
+ * LCP. LCP is cut into blocks of LCE_BLOCK_SIZE, the sparse table is over
+ * the block minima only (level l holds the minimum of 2^l blocks from each
+ * block), and the ends of a query are scanned inside their blocks. The
+ * table is n / LCE_BLOCK_SIZE * log(n) ints instead of n log(n), and the
+ * scans stay inside one or two cache lines of LCP.
+ *
+ * @param SA_array The address to the SA array (with the $ suffix).
+ * @param text The address to the text.
+ * @param lce The address to the LCE structure.
+ */
+void build_LCE(vector<int> &SA_array, string &text, LCE_index &lce){
+  int n = (int) SA_array.size();
+  lce.text_size = (int) text.size();
+  compute_LCP_array(SA_array, text, lce.LCP);
+  lce.ISA.resize(n);
+  for(int i = 0; i < n; i++){
+    lce.ISA[SA_array[i]] = i;
+  }
+
+  lce.blocks = (n + LCE_BLOCK_SIZE - 1) / LCE_BLOCK_SIZE;
+  lce.levels = 1;
+  while((1 << lce.levels) <= lce.blocks){
+    lce.levels++;
+  }
+  lce.sparse.assign((size_t) lce.levels * lce.blocks, 0);
+  for(int b = 0; b < lce.blocks; b++){
+    int end = min(n, (b + 1) * LCE_BLOCK_SIZE);
+    int minimum = lce.LCP[b * LCE_BLOCK_SIZE];
+    for(int i = b * LCE_BLOCK_SIZE + 1; i < end; i++){
+      minimum = min(minimum, lce.LCP[i]);
+    }
+    lce.sparse[b] = minimum;
+  }
+  for(int level = 1; level < lce.levels; level++){
+    int *row = &lce.sparse[(size_t) level * lce.blocks];
+    int *above = &lce.sparse[(size_t) (level - 1) * lce.blocks];
+    int half = 1 << (level - 1);
+    for(int b = 0; b + (1 << level) <= lce.blocks; b++){
+      row[b] = min(above[b], above[b + half]);
+    }
+  }
+}
+
+/**
+ * int lce_range_min
+ *
+ * The minimum of LCP[l..r]. Scans the partial blocks at the ends and looks
+ * up the full blocks in between with two overlapping sparse table entries.
+ *
+ * @param lce The address to the LCE structure.
+ * @param l The first index.
+ * @param r The last index (l <= r).
+ * @return The minimum.
+ */
+int lce_range_min(LCE_index &lce, int l, int r){
+  const int *LCP = lce.LCP.data();
+  int left_block = l / LCE_BLOCK_SIZE;
+  int right_block = r / LCE_BLOCK_SIZE;
+  int minimum = LCP[l];
+
+  if(left_block == right_block){
+    for(int i = l + 1; i <= r; i++){
+      minimum = min(minimum, LCP[i]);
+    }
+    return minimum;
+  }
+  for(int i = l + 1; i < (left_block + 1) * LCE_BLOCK_SIZE; i++){
+    minimum = min(minimum, LCP[i]);
+  }
+  for(int i = right_block * LCE_BLOCK_SIZE; i <= r; i++){
+    minimum = min(minimum, LCP[i]);
+  }
+  if(right_block - left_block > 1){
+    int first = left_block + 1;
+    int count = right_block - first;
+    int level = 31 - __builtin_clz(count);
+    minimum = min(minimum, lce.sparse[(size_t) level * lce.blocks + first]);
+    minimum = min(minimum, lce.sparse[(size_t) level * lce.blocks + right_block - (1 << level)]);
+  }
+  return minimum;
+}
+
+/**
+ * int lce_query
+ *
+ * LCE(i, j), the length of the longest common prefix of the suffixes at i
+ * and j: the minimum of LCP between their ranks.
+ *
+ * @param lce The address to the LCE structure.
+ * @param i A text position.
+ * @param j A text position.
+ * @return The length.
+ */
+int lce_query(LCE_index &lce, int i, int j){
+  if(i == j){
+    return lce.text_size - i;
+  }
+  int r1 = lce.ISA[i];
+  int r2 = lce.ISA[j];
+  if(r1 > r2){
+    swap(r1, r2);
+  }
+  return lce_range_min(lce, r1 + 1, r2);
+}
+
+/**
+ * void lce_batch
+ *
+ * Answers a batch of LCE queries. The ISA entries of queries a few places
+ * ahead are prefetched, so the random ISA reads of different queries
+ * overlap instead of each one waiting for memory.
+ *
+ * @param lce The address to the LCE structure.
+ * @param queries The address to the (i, j) pairs.
+ * @param answers The address to store the lengths in.
+ */
+void lce_batch(LCE_index &lce, vector<pair<int, int> > &queries, vector<int> &answers){
+  int count = (int) queries.size();
+  answers.resize(count);
+  for(int q = 0; q < count; q++){
+    if(q + LCE_PREFETCH_DISTANCE < count){
+      __builtin_prefetch(&lce.ISA[queries[q + LCE_PREFETCH_DISTANCE].first]);
+      __builtin_prefetch(&lce.ISA[queries[q + LCE_PREFETCH_DISTANCE].second]);
+    }
+    answers[q] = lce_query(lce, queries[q].first, queries[q].second);
+  }
+}
+
+/**
+ * int run_lce_mode
+ *
+ * Reads "i j" pairs from the query file and prints LCE(i, j) for each.
+ *
+ * @param SA_array The address to the SA array.
+ * @param inputted_string The address to the inputted string.
+ * @param query_file The file with one pair per line.
+ * @return -1 Returns an error if the file can't be read or a position is
+ *         outside of the text.
+ * @return 0 Finished.
+ */
+int run_lce_mode(vector<int> &SA_array, string &inputted_string, string query_file){
+  vector<string> lines;
+  vector<pair<int, int> > queries;
+  vector<int> answers;
+  int n = (int) inputted_string.size();
+
+  if(!read_lines(query_file, lines)){
+    cerr << "ERROR: can't read query file <" << query_file << ">." << endl;
+    return -1;
+  }
+  for(int k = 0; k < (int) lines.size(); k++){
+    istringstream line(lines[k]);
+    int i, j;
+    if(!(line >> i >> j) || i < 0 || j < 0 || i >= n || j >= n){
+      cerr << "ERROR: bad query <" << lines[k] << ">." << endl;
+      return -1;
+    }
+    queries.push_back(make_pair(i, j));
+  }
+
+  LCE_index lce;
+  build_LCE(SA_array, inputted_string, lce);
+  lce_batch(lce, queries, answers);
+  for(int q = 0; q < (int) answers.size(); q++){
+    cout << answers[q] << endl;
+  }
+  return 0;
+}
+
+/**
+ * int run_lce_bench
+ *
+ * Microbenchmark of LCE queries on generated texts of length n: a random
+ * text over 4 letters (short LCEs), copies of one block with a few changes
+ * (long LCEs, like a collection of similar genomes) and the Fibonacci word.
+ * Random pairs (a period apart in the repetitive texts) are answered by the
+ * batch API and by naive_lcp, which must agree.
+ *
+ * @param n The text length.
+ * @param query_count The number of queries.
+ * @return -1 Returns an error if the answers differ.
+ * @return 0 Finished.
+ */
+int run_lce_bench(int n, int query_count){
+  const char *names[3] = {"random text:    ", "repeated text:  ", "Fibonacci word: "};
+  for(int kind = 0; kind < 3; kind++){
+    string text;
+    srand(1);
+    if(kind == 0){
+      for(int i = 0; i < n; i++){
+        text.push_back("acgt"[rand() % 4]);
+      }
+    }
+    else if(kind == 1){
+      // Copies of one random 10000 letter block, 1 in 1000 letters changed.
+      string block;
+      for(int i = 0; i < 10000; i++){
+        block.push_back("acgt"[rand() % 4]);
+      }
+      for(int i = 0; i < n; i++){
+        text.push_back(rand() % 1000 == 0 ? "acgt"[rand() % 4] : block[i % 10000]);
+      }
+    }
+    else{
+      string previous = "a";
+      text = "ab";
+      while((int) text.size() < n){
+        string next = text + previous;
+        previous = text;
+        text = next;
+      }
+      text.resize(n);
+    }
+
+    int size_of_string = n + 1;
+    int recursion_counter = 0;
+    vector<int> T_array(size_of_string);
+    vector<int> SA_array(size_of_string, -1);
+    assign_index_to_T(T_array, text, size_of_string);
+    run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+
+    LCE_index lce;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    build_LCE(SA_array, text, lce);
+    double build_seconds = seconds_since(start);
+
+    // Pairs that are a period apart in the repetitive texts (a block length,
+    // a Fibonacci number), so that the LCEs there are long.
+    vector<int> periods(1, 0);
+    if(kind == 1){
+      for(int p = 10000; p < n; p = p + 10000){
+        periods.push_back(p);
+      }
+    }
+    if(kind == 2){
+      for(int a = 1, b = 2; b < n; b = a + b, a = b - a){
+        periods.push_back(b);
+      }
+    }
+    vector<pair<int, int> > queries(query_count);
+    srand(2);
+    for(int q = 0; q < query_count; q++){
+      int i = rand() % n;
+      int j = (kind == 0) ? rand() % n : (i + periods[rand() % periods.size()]) % n;
+      queries[q] = make_pair(i, j);
+    }
+    vector<int> answers;
+    start = chrono::steady_clock::now();
+    lce_batch(lce, queries, answers);
+    double lce_seconds = seconds_since(start);
+
+    long long naive_total = 0;
+    long long lce_total = 0;
+    start = chrono::steady_clock::now();
+    for(int q = 0; q < query_count; q++){
+      naive_total = naive_total + naive_lcp(text, queries[q].first, queries[q].second);
+    }
+    double naive_seconds = seconds_since(start);
+    for(int q = 0; q < query_count; q++){
+      lce_total = lce_total + answers[q];
+    }
+    if(lce_total != naive_total){
+      cerr << "ERROR: LCE total " << lce_total << ", naive total " << naive_total << "." << endl;
+      return -1;
+    }
+
+    cerr << names[kind] << n << " chars, "
+      << query_count << " queries, average LCE " << (double) lce_total / query_count << endl;
+    cerr << "  build " << build_seconds << " s, LCE " << 1e9 * lce_seconds / query_count
+      << " ns/query, naive " << 1e9 * naive_seconds / query_count << " ns/query" << endl;
+  }
+  return 0;
+}
+
+/**
+ * void mem_merge
+ *
+ * Adds the positions of a finished child interval to its parent. If the
+ * parent is deep enough, every A position of one and B position of the
+ * other with different characters before them (or nothing before them)
+ * start a maximal exact match of length parent.lcp: the match can't go
+ * further right since they are in different children, and can't go further
+ * left since the characters before differ. Intervals below min_length keep
+ * no positions, no interval above them can report anything.
+ *
+ * @param parent The address to the parent interval.
+ * @param child The address to the child interval.
+ * @param next_row The address to the list links, one per SA row.
+ * @param context The address to the search (SA, sizes and output).
+ */
+void mem_merge(MEM_interval &parent, MEM_interval &child, vector<int> &next_row,
+  MEM_search &context){
+  if(parent.lcp < context.min_length){
+    return;
+  }
+  for(int c = 0; c < (int) child.lists.size(); c++){
+    Position_list &from = child.lists[c];
+    for(int p = 0; p < (int) parent.lists.size(); p++){
+      Position_list &to = parent.lists[p];
+      if(from.side == to.side || (from.left == to.left && from.left != MEM_NO_LEFT)){
+        continue;
+      }
+      for(int a = from.head; a != -1; a = next_row[a]){
+        for(int b = to.head; b != -1; b = next_row[b]){
+          int x = context.SA[a];
+          int y = context.SA[b];
+          if(from.side == 1){
+            swap(x, y);
+          }
+          context.output << x << " " << y - context.size_of_A - 1 << " " << parent.lcp << "\n";
+          context.mem_count++;
+        }
+      }
+    }
+  }
+  for(int c = 0; c < (int) child.lists.size(); c++){
+    Position_list &from = child.lists[c];
+    int p = 0;
+    while(p < (int) parent.lists.size() &&
+      (parent.lists[p].side != from.side || parent.lists[p].left != from.left)){
+      p++;
+    }
+    if(p == (int) parent.lists.size()){
+      parent.lists.push_back(from);
+    }
+    else{
+      next_row[parent.lists[p].tail] = from.head;
+      parent.lists[p].tail = from.tail;
+    }
+  }
+  if(context.output.tellp() > (1 << 20)){
+    *context.sink << context.output.str();
+    context.output.str("");
+  }
+}
+
+/**
+ * void mem_report
+ *
+ * Longest common substring and maximal exact matches of A and B (raw
+ * bytes). SAIS runs on A#B$ with # named 1 and the bytes from 2, so no
+ * common prefix crosses the #. A first pass over SA and LCP finds the LCS
+ * (the largest LCP between an A and a B suffix next to each other), which
+ * is printed before anything else; a second pass, with a stack of the open
+ * lcp-intervals, finds every MEM of at least min_length and prints them
+ * 1 MB at a time.
+ *
+ * Prints "lcs LENGTH POS_A POS_B", then one "POS_A POS_B LENGTH" line per
+ * MEM.
+ *
+ * @param A The first text.
+ * @param B The second text.
+ * @param min_length The shortest MEM to report.
+ * @param out Where to print.
+ */
+void mem_report(string &A, string &B, int min_length, ostream &out){
+  MEM_search context;
+  context.size_of_A = (int) A.size();
+  context.min_length = max(min_length, 1);
+  context.mem_count = 0;
+  context.sink = &out;
+
+  // A # B $, with # = 1 and the bytes named from 2 in order.
+  int size_of_string = (int) (A.size() + B.size()) + 2;
+  vector<int> T_array(size_of_string, 0);
+  int is_in_array[256] = {0};
+  int new_name[256] = {0};
+  for(int i = 0; i < (int) A.size(); i++){
+    is_in_array[(unsigned char) A[i]] = 1;
+  }
+  for(int i = 0; i < (int) B.size(); i++){
+    is_in_array[(unsigned char) B[i]] = 1;
+  }
+  int counter_index = 2;
+  for(int c = 0; c < 256; c++){
+    if(is_in_array[c]){
+      new_name[c] = counter_index++;
+    }
+  }
+  for(int i = 0; i < (int) A.size(); i++){
+    T_array[i] = new_name[(unsigned char) A[i]];
+  }
+  T_array[A.size()] = 1;
+  for(int i = 0; i < (int) B.size(); i++){
+    T_array[A.size() + 1 + i] = new_name[(unsigned char) B[i]];
+  }
+
+  int recursion_counter = 0;
+  context.SA.assign(size_of_string, -1);
+  run_SAIS(context.SA, T_array, size_of_string, recursion_counter);
+  vector<int> LCP_array;
+  compute_LCP_array(context.SA, T_array, LCP_array);
+  vector<int>().swap(T_array);
+
+  // next_row links the SA rows of each (side, preceding character) list of
+  // an interval; -1 ends a list.
+  int n = size_of_string;
+  vector<int> next_row(n, -1);
+  int lcs = 0;
+  int lcs_A = -1;
+  int lcs_B = -1;
+
+  // LCS: neighbours from different sides.
+  for(int i = 1; i < n; i++){
+    int h = LCP_array[i];
+    if(h <= lcs){
+      continue;
+    }
+    int p = context.SA[i - 1];
+    int q = context.SA[i];
+    int side_p = (p < context.size_of_A) ? 0 : (p > context.size_of_A && p < n - 1) ? 1 : -1;
+    int side_q = (q < context.size_of_A) ? 0 : (q > context.size_of_A && q < n - 1) ? 1 : -1;
+    if(side_p >= 0 && side_q >= 0 && side_p != side_q){
+      lcs = h;
+      lcs_A = side_p == 0 ? p : q;
+      lcs_B = (side_p == 0 ? q : p) - context.size_of_A - 1;
+    }
+  }
+  out << "lcs " << lcs << " " << lcs_A << " " << lcs_B << "\n";
+
+  vector<MEM_interval> stack(1);
+  stack[0].lcp = 0;
+  for(int i = 1; i <= n; i++){
+    int p = context.SA[i - 1];
+    int h = (i < n) ? LCP_array[i] : 0;
+
+    MEM_interval leaf;
+    if(p != context.size_of_A && p != n - 1){
+      Position_list list;
+      list.side = (p < context.size_of_A) ? 0 : 1;
+      bool at_start = (p == 0 || p == context.size_of_A + 1);
+      list.left = at_start ? MEM_NO_LEFT : (unsigned char) (list.side == 0 ? A[p - 1] :
+        B[p - context.size_of_A - 2]);
+      list.head = list.tail = i - 1;
+      leaf.lists.push_back(list);
+    }
+
+    // The leaf is the last child of the intervals that close here, or the
+    // first child of the one that opens.
+    MEM_interval last;
+    last.lists.swap(leaf.lists);
+    while(h < stack.back().lcp){
+      mem_merge(stack.back(), last, next_row, context);
+      last.lcp = stack.back().lcp;
+      last.lists.swap(stack.back().lists);
+      stack.pop_back();
+    }
+    if(h > stack.back().lcp){
+      stack.push_back(MEM_interval());
+      stack.back().lcp = h;
+    }
+    mem_merge(stack.back(), last, next_row, context);
+  }
+
+  out << context.output.str();
+  out.flush();
+  if(DEBUG){
+    cerr << context.mem_count << " MEMs" << endl;
+  }
+}
+
+/**
+ * int run_mem_mode
+ *
+ * Runs mem_report on two files.
+ *
+ * @param file_A The first file.
+ * @param file_B The second file.
+ * @param min_length The shortest MEM to report.
+ * @return -1 Returns an error if a file can't be read.
+ * @return 0 Finished.
+ */
+int run_mem_mode(string file_A, string file_B, int min_length){
+  ifstream input_A(file_A.c_str(), ios::binary);
+  ifstream input_B(file_B.c_str(), ios::binary);
+  if(!input_A || !input_B){
+    cerr << "ERROR: can't read <" << (input_A ? file_B : file_A) << ">." << endl;
+    return -1;
+  }
+  string A((istreambuf_iterator<char>(input_A)), istreambuf_iterator<char>());
+  string B((istreambuf_iterator<char>(input_B)), istreambuf_iterator<char>());
+  mem_report(A, B, min_length, cout);
+  return 0;
+}
+
+/**
+ * int run_mem_check
+ *
+ * Regression check for mem_report with more than 1 MB of MEMs: A and B are
+ * 400 copies of one random 40 letter block, ended by "A" in A and by "B" in
+ * B, so every copy in A matches every copy in B in a MEM of exactly 40
+ * (160000 MEMs). The lcs line must come first and be a real match of 40,
+ * and every other line must be one of those MEMs.
+ *
+ * @return -1 Returns an error if the output is wrong.
+ * @return 0 Finished.
+ */
+int run_mem_check(){
+  const int copies = 400;
+  const int block_length = 40;
+  string block;
+  srand(1);
+  for(int i = 0; i < block_length; i++){
+    block.push_back("acgt"[rand() % 4]);
+  }
+  string A, B;
+  for(int c = 0; c < copies; c++){
+    A = A + block + "A";
+    B = B + block + "B";
+  }
+
+  ostringstream output;
+  mem_report(A, B, block_length, output);
+  string result = output.str();
+  istringstream lines(result);
+  string line;
+  long long line_count = 0;
+  int errors = 0;
+  while(getline(lines, line)){
+    istringstream fields(line);
+    if(line_count == 0){
+      string word;
+      int length, a, b;
+      fields >> word >> length >> a >> b;
+      if(word != "lcs" || length != block_length || a < 0 || b < 0 ||
+        A.compare(a, length, B, b, length) != 0){
+        errors++;
+      }
+    }
+    else{
+      int a, b, length;
+      fields >> a >> b >> length;
+      if(length != block_length || a % (block_length + 1) != 0 ||
+        b % (block_length + 1) != 0){
+        errors++;
+      }
+    }
+    line_count++;
+  }
+  cerr << result.size() << " bytes, " << line_count << " lines" << endl;
+  if(line_count != (long long) copies * copies + 1 || result.size() <= (1 << 20) ||
+    errors > 0){
+    cerr << "ERROR: -mem-check found " << errors << " wrong lines." << endl;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * void pfp_find_triggers
+ *
+ * Finds the triggers of prefix-free parsing that start in [first, last): the
+ * positions s > 0 where the window text[s, s + window) lies in the text and
+ * its Karp-Rabin hash is 0 modulo modulus. The hash of the first window is
+ * computed directly, the rest are rolled.
+ *
+ * @param text The text.
+ * @param window The window size W.
+ * @param modulus The modulus P.
+ * @param first The first start position to look at.
+ * @param last One past the last start position to look at.
+ * @param triggers The address to the trigger positions (appended, in order).
+ */
+void pfp_find_triggers(string &text, int window, int modulus, int first, int last,
+  vector<int> &triggers){
+  int n = (int) text.size();
+  first = max(first, 1);
+  last = min(last, n - window + 1);
+  if(first >= last){
+    return;
+  }
+
+  // B^(W-1), to take the leaving character out of the hash.
+  unsigned long long top = 1;
+  for(int i = 1; i < window; i++){
+    top = top * PFP_HASH_BASE % PFP_HASH_PRIME;
+  }
+  unsigned long long hash = 0;
+  for(int i = first; i < first + window; i++){
+    hash = (hash * PFP_HASH_BASE + (unsigned char) text[i]) % PFP_HASH_PRIME;
+  }
+
+  for(int s = first; s < last; s++){
+    if(hash % modulus == 0){
+      triggers.push_back(s);
+    }
+    if(s + window < n){
+      unsigned long long out = (unsigned char) text[s] * top % PFP_HASH_PRIME;
+      hash = (hash + PFP_HASH_PRIME - out) % PFP_HASH_PRIME;
+      hash = (hash * PFP_HASH_BASE + (unsigned char) text[s + window]) % PFP_HASH_PRIME;
+    }
+  }
+}
+
+/**
+ * void pfp_parse_text
+ *
+ * Prefix-free parsing of text$^W. Phrase k starts at the k-th cut (0, then
+ * every trigger) and runs to the end of the next trigger, or to the end of
+ * $^W for the last phrase. The text is cut into chunks; the triggers of each
+ * chunk are found and its phrases put into a local dictionary on
+ * thread_count threads, then the local dictionaries are merged.
+ *
+ * @param text The text.
+ * @param window The window size W.
+ * @param modulus The modulus P.
+ * @param thread_count The number of threads.
+ * @param result The address to the dictionary and parse.
+ */
+void pfp_parse_text(string &text, int window, int modulus, int thread_count,
+  PFP_parse &result){
+  int n = (int) text.size();
+  int chunk_count = max(1, min(4 * thread_count, n / PFP_MIN_CHUNK));
+  vector<vector<int> > chunk_triggers(chunk_count);
+
+  run_block_workers(chunk_count, thread_count, [&](int c){
+    int first = (int) ((long long) n * c / chunk_count);
+    int last = (int) ((long long) n * (c + 1) / chunk_count);
+    pfp_find_triggers(text, window, modulus, first, last, chunk_triggers[c]);
+  });
+
+  // Where every phrase starts, and the first phrase of every chunk (phrase 0
+  // belongs to chunk 0).
+  vector<int> starts(1, 0);
+  vector<int> first_phrase(chunk_count + 1);
+  for(int c = 0; c < chunk_count; c++){
+    first_phrase[c] = (c == 0) ? 0 : (int) starts.size();
+    starts.insert(starts.end(), chunk_triggers[c].begin(), chunk_triggers[c].end());
+    vector<int>().swap(chunk_triggers[c]);
+  }
+  first_phrase[chunk_count] = (int) starts.size();
+  int phrase_count = (int) starts.size();
+
+  // Local dictionaries. The last phrase ends in $^W and is never equal to
+  // another one, it is added after the merge.
+  result.window = window;
+  result.parse.assign(phrase_count, -1);
+  vector<vector<string> > local_phrases(chunk_count);
+  run_block_workers(chunk_count, thread_count, [&](int c){
+    unordered_map<string, int> ids;
+    for(int k = first_phrase[c]; k < first_phrase[c + 1] && k < phrase_count - 1; k++){
+      string phrase = text.substr(starts[k], starts[k + 1] + window - starts[k]);
+      unordered_map<string, int>::iterator found = ids.find(phrase);
+      if(found == ids.end()){
+        found = ids.insert(make_pair(phrase, (int) local_phrases[c].size())).first;
+        local_phrases[c].push_back(phrase);
+      }
+      result.parse[k] = found->second;
+    }
+  });
+
+  unordered_map<string, int> ids;
+  result.phrases.clear();
+  for(int c = 0; c < chunk_count; c++){
+    vector<int> global_id(local_phrases[c].size());
+    for(int i = 0; i < (int) local_phrases[c].size(); i++){
+      unordered_map<string, int>::iterator found = ids.find(local_phrases[c][i]);
+      if(found == ids.end()){
+        found = ids.insert(make_pair(local_phrases[c][i], (int) result.phrases.size())).first;
+        result.phrases.push_back(local_phrases[c][i]);
+      }
+      global_id[i] = found->second;
+    }
+    vector<string>().swap(local_phrases[c]);
+    for(int k = first_phrase[c]; k < first_phrase[c + 1] && k < phrase_count - 1; k++){
+      result.parse[k] = global_id[result.parse[k]];
+    }
+  }
+  result.last_phrase = (int) result.phrases.size();
+  result.phrases.push_back(text.substr(starts[phrase_count - 1]));
+  result.parse[phrase_count - 1] = result.last_phrase;
+}
+
+/**
+ * void pfp_build_BWT
+ *
+ * Builds the BWT of text$ from its prefix-free parse, in the format of
+ * print_BWT (the row of suffix 0 is left out). Every suffix of text$^W
+ * starts with a suffix alpha (longer than W) of its phrase, and the suffixes
+ * of length > W of the phrases are prefix-free, so suffixes of T sort by
+ * alpha first and, for equal alpha, by the parse suffix after the phrase.
+ *
+ * SAIS runs on the dictionary (phrase#phrase#...$) to sort the alphas and
+ * rank the phrases, then on the parse. For each alpha in order, the BWT gets
+ * the character before alpha in its phrase, or the character before the
+ * phrase in the text when alpha is the whole phrase. Only when those differ
+ * do the occurrences have to be put in parse order.
+ *
+ * @param text The text.
+ * @param pfp The address to the parse of text.
+ * @param BWT The address to the BWT.
+ */
+void pfp_build_BWT(string &text, PFP_parse &pfp, string &BWT){
+  int n = (int) text.size();
+  int w = pfp.window;
+  int recursion_counter = 0;
+  int phrase_count = (int) pfp.phrases.size();
+  BWT.clear();
+  if(n == 0){
+    return;
+  }
+
+  // The dictionary with $ = 0, # = 1, the $ of the text 2, and the bytes
+  // from 3 in order.
+  int is_in_array[256] = {0};
+  int new_name[256] = {0};
+  for(int i = 0; i < phrase_count; i++){
+    for(int j = 0; j < (int) pfp.phrases[i].size(); j++){
+      is_in_array[(unsigned char) pfp.phrases[i][j]] = 1;
+    }
+  }
+  int counter_index = 3;
+  for(int c = 0; c < 256; c++){
+    if(is_in_array[c]){
+      new_name[c] = counter_index++;
+    }
+  }
+
+  vector<int> dict_start(phrase_count);
+  vector<int> dict_length(phrase_count);
+  int dict_size = 1;
+  for(int i = 0; i < phrase_count; i++){
+    dict_start[i] = dict_size - 1;
+    dict_length[i] = (int) pfp.phrases[i].size() + (i == pfp.last_phrase ? w : 0);
+    dict_size = dict_size + dict_length[i] + 1;
+  }
+  vector<int> T_dict(dict_size, 0);
+  vector<int> owner(dict_size, -1);
+  for(int i = 0; i < phrase_count; i++){
+    int p = dict_start[i];
+    for(int j = 0; j < (int) pfp.phrases[i].size(); j++){
+      owner[p] = i;
+      T_dict[p++] = new_name[(unsigned char) pfp.phrases[i][j]];
+    }
+    for(int j = (int) pfp.phrases[i].size(); j < dict_length[i]; j++){
+      owner[p] = i;
+      T_dict[p++] = 2;
+    }
+    T_dict[p] = 1;
+  }
+  vector<int> SA_dict(dict_size, -1);
+  run_SAIS(SA_dict, T_dict, dict_size, recursion_counter);
+  vector<int> LCP_dict;
+  compute_LCP_array(SA_dict, T_dict, LCP_dict);
+
+  // Prefix-free and distinct, so the phrases rank like their suffixes.
+  vector<int> phrase_rank(phrase_count);
+  int rank = 0;
+  for(int r = 0; r < dict_size; r++){
+    int q = SA_dict[r];
+    if(owner[q] >= 0 && dict_start[owner[q]] == q){
+      phrase_rank[owner[q]] = ++rank;
+    }
+  }
+
+  // SAIS on the parse, then the occurrences of every phrase in the order of
+  // the parse suffix after them (row is that suffix's rank).
+  int parse_size = (int) pfp.parse.size() + 1;
+  vector<int> T_parse(parse_size, 0);
+  for(int k = 0; k < parse_size - 1; k++){
+    T_parse[k] = phrase_rank[pfp.parse[k]];
+  }
+  vector<int> SA_parse(parse_size, -1);
+  run_SAIS(SA_parse, T_parse, parse_size, recursion_counter);
+  vector<int>().swap(T_parse);
+
+  vector<int> occ_start(phrase_count + 1, 0);
+  for(int k = 0; k < parse_size - 1; k++){
+    occ_start[pfp.parse[k] + 1]++;
+  }
+  for(int i = 0; i < phrase_count; i++){
+    occ_start[i + 1] = occ_start[i + 1] + occ_start[i];
+  }
+  vector<int> fill(occ_start.begin(), occ_start.end() - 1);
+  vector<int> occ_row(parse_size - 1);
+  vector<int> occ_pos(parse_size - 1);
+  for(int r = 0; r < parse_size; r++){
+    int k = SA_parse[r] - 1;
+    if(k >= 0){
+      occ_row[fill[pfp.parse[k]]] = r;
+      occ_pos[fill[pfp.parse[k]]++] = k;
+    }
+  }
+  vector<int>().swap(SA_parse);
+
+  // The $ row comes first.
+  BWT.reserve(n);
+  BWT.push_back(text[n - 1]);
+
+  vector<pair<int, int> > members;
+  vector<pair<int, char> > items;
+  int r = 0;
+  while(r < dict_size){
+    int q = SA_dict[r];
+    int id = owner[q];
+    int length = (id >= 0) ? dict_start[id] + dict_length[id] - q : 0;
+    if(length <= w){
+      r++;
+      continue;
+    }
+
+    // Equal alphas are next to each other.
+    members.clear();
+    members.push_back(make_pair(id, q - dict_start[id]));
+    r++;
+    while(r < dict_size && LCP_dict[r] >= length){
+      int q2 = SA_dict[r];
+      members.push_back(make_pair(owner[q2], q2 - dict_start[owner[q2]]));
+      r++;
+    }
+
+    bool same = true;
+    for(int m = 0; m < (int) members.size() && same; m++){
+      same = members[m].second > 0 && pfp.phrases[members[m].first][members[m].second - 1] ==
+        pfp.phrases[members[0].first][members[0].second - 1];
+    }
+    if(same){
+      char c = pfp.phrases[members[0].first][members[0].second - 1];
+      for(int m = 0; m < (int) members.size(); m++){
+        BWT.append(occ_start[members[m].first + 1] - occ_start[members[m].first], c);
+      }
+      continue;
+    }
+
+    items.clear();
+    for(int m = 0; m < (int) members.size(); m++){
+      int phrase = members[m].first;
+      int offset = members[m].second;
+      for(int o = occ_start[phrase]; o < occ_start[phrase + 1]; o++){
+        int k = occ_pos[o];
+        if(offset > 0){
+          items.push_back(make_pair(occ_row[o], pfp.phrases[phrase][offset - 1]));
+        }
+        else if(k > 0){
+          string &previous = pfp.phrases[pfp.parse[k - 1]];
+          items.push_back(make_pair(occ_row[o], previous[previous.size() - w - 1]));
+        }
+      }
+    }
+    sort(items.begin(), items.end());
+    for(int m = 0; m < (int) items.size(); m++){
+      BWT.push_back(items[m].second);
+    }
+  }
+}
+
+/**
+ * int run_pfp_mode
+ *
+ * Handles -pfp and -pfp-bench. The optional arguments are the window W, the
+ * modulus P and the number of threads (default all cores). -pfp prints the
+ * BWT like the default mode. The bench also runs SAIS on the whole text,
+ * checks the two BWTs are the same, and reports both times and the sizes of
+ * the dictionary and the parse to stderr.
+ *
+ * @param inputted_string The text.
+ * @param mode The mode.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return -1 Returns an error (bad arguments, or the BWTs differ).
+ * @return 0 Finished.
+ */
+int run_pfp_mode(string &inputted_string, string mode, int argc, char *argv[]){
+  int window = argc > 2 ? atoi(argv[2]) : PFP_DEFAULT_WINDOW;
+  int modulus = argc > 3 ? atoi(argv[3]) : PFP_DEFAULT_MODULUS;
+  int thread_count = argc > 4 ? atoi(argv[4]) : (int) thread::hardware_concurrency();
+  if(window < 1 || modulus < 1){
+    cerr << "ERROR: " << mode << " needs a positive window and modulus." << endl;
+    return -1;
+  }
+  if(thread_count < 1){
+    thread_count = 1;
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  PFP_parse pfp;
+  pfp_parse_text(inputted_string, window, modulus, thread_count, pfp);
+  double parse_seconds = seconds_since(start);
+  start = chrono::steady_clock::now();
+  string BWT;
+  pfp_build_BWT(inputted_string, pfp, BWT);
+  double bwt_seconds = seconds_since(start);
+
+  if(mode == "-pfp"){
+    cout << BWT << endl;
+    return 0;
+  }
+
+  long long dictionary_size = 0;
+  for(int i = 0; i < (int) pfp.phrases.size(); i++){
+    dictionary_size = dictionary_size + pfp.phrases[i].size();
+  }
+
+  int size_of_string = (int) inputted_string.size() + 1;
+  int recursion_counter = 0;
+  start = chrono::steady_clock::now();
+  vector<int> T_array(size_of_string);
+  vector<int> SA_array(size_of_string, -1);
+  assign_index_to_T(T_array, inputted_string, size_of_string);
+  run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+  string direct;
+  direct.reserve(inputted_string.size());
+  for(int i = 0; i < size_of_string; i++){
+    if(SA_array[i] > 0){
+      direct.push_back(inputted_string[SA_array[i] - 1]);
+    }
+  }
+  double sais_seconds = seconds_since(start);
+
+  cerr << "text: " << inputted_string.size() << " chars, W = " << window << ", P = " <<
+    modulus << ", " << thread_count << " threads" << endl;
+  cerr << "dictionary: " << pfp.phrases.size() << " phrases, " << dictionary_size <<
+    " chars; parse: " << pfp.parse.size() << " phrases" << endl;
+  cerr << "pfp: parse " << parse_seconds << " s + BWT " << bwt_seconds << " s = " <<
+    parse_seconds + bwt_seconds << " s" << endl;
+  cerr << "SAIS on the text: " << sais_seconds << " s" << endl;
+  if(direct != BWT){
+    cerr << "ERROR: the prefix-free parsing BWT differs from SAIS." << endl;
+    return -1;
+  }
+  cerr << "BWTs match" << endl;
+  return 0;
+}
+
+/**
+ * int is_word_char
+ *
+ * Letters, digits and every byte >= 128 (so UTF-8 letters stay in their word)
+ * make up words; everything else separates them.
+ *
+ * @param c The byte.
+ * @return 1 if c belongs to a word, 0 if not.
+ */
+int is_word_char(unsigned char c){
+  return c >= 128 || isalnum(c);
+}
+
+/**
+ * void build_word_SA
+ *
+ * Sorts the suffixes of the text that start a word, without sorting the
+ * others. The text is cut into tokens: a word with the one byte after it, or
+ * a single separator byte that doesn't follow a word. No token is a prefix
+ * of another one (a word token ends in a separator, or in $ at the end), so
+ * suffixes that start at tokens sort like the strings of token names. The
+ * distinct tokens are named 1.. in sorted order and SAIS runs on the names.
+ *
+ * @param text The text.
+ * @param word_SA The address to the sorted start positions of the words.
+ */
+void build_word_SA(string &text, vector<int> &word_SA){
+  int n = (int) text.size();
+  vector<int> token_start;
+  vector<int> token_length;
+  for(int i = 0; i < n;){
+    int j = i;
+    while(j < n && is_word_char(text[j])){
+      j++;
+    }
+    if(j < n){
+      j++;
+    }
+    token_start.push_back(i);
+    token_length.push_back(j - i);
+    i = j;
+  }
+
+  // Name the tokens in sorted order.
+  int token_count = (int) token_start.size();
+  unordered_map<string, int> ids;
+  vector<string> distinct;
+  vector<int> T_array(token_count + 1, 0);
+  for(int k = 0; k < token_count; k++){
+    string token = text.substr(token_start[k], token_length[k]);
+    unordered_map<string, int>::iterator found = ids.find(token);
+    if(found == ids.end()){
+      found = ids.insert(make_pair(token, (int) distinct.size())).first;
+      distinct.push_back(token);
+    }
+    T_array[k] = found->second;
+  }
+  vector<int> order(distinct.size());
+  for(int i = 0; i < (int) order.size(); i++){
+    order[i] = i;
+  }
+  sort(order.begin(), order.end(), [&](int a, int b){
+    return distinct[a] < distinct[b];
+  });
+  vector<int> new_name(distinct.size());
+  for(int i = 0; i < (int) order.size(); i++){
+    new_name[order[i]] = i + 1;
+  }
+  for(int k = 0; k < token_count; k++){
+    T_array[k] = new_name[T_array[k]];
+  }
+
+  int recursion_counter = 0;
+  vector<int> SA_array(token_count + 1, -1);
+  run_SAIS(SA_array, T_array, token_count + 1, recursion_counter);
+
+  word_SA.clear();
+  for(int r = 1; r <= token_count; r++){
+    int p = token_start[SA_array[r]];
+    if(is_word_char(text[p])){
+      word_SA.push_back(p);
+    }
+  }
+}
+
+/**
+ * int run_words_mode
+ *
+ * Handles -words and -words-bench. The text is the raw bytes of stdin. For
+ * every line of the pattern file, prints the number of words that start
+ * with it (binary search over the word suffix array). The bench also builds
+ * the suffix array of every position with SAIS and keeps the word starts,
+ * checks that it gives the same array, and reports both to stderr.
+ *
+ * @param mode The mode.
+ * @param pattern_file The file with one pattern per line.
+ * @return -1 Returns an error (no pattern file, or the arrays differ).
+ * @return 0 Finished.
+ */
+int run_words_mode(string mode, string pattern_file){
+  string text((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+  vector<string> patterns;
+  if(!read_lines(pattern_file, patterns)){
+    cerr << "ERROR: can't read pattern file <" << pattern_file << ">." << endl;
+    return -1;
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<int> word_SA;
+  build_word_SA(text, word_SA);
+  double word_seconds = seconds_since(start);
+
+  start = chrono::steady_clock::now();
+  long long total = 0;
+  for(int i = 0; i < (int) patterns.size(); i++){
+    int count = sa_binary_search_count(word_SA, text, patterns[i]);
+    total = total + count;
+    if(mode == "-words"){
+      cout << count << endl;
+    }
+  }
+  double search_seconds = seconds_since(start);
+  if(mode == "-words"){
+    return 0;
+  }
+
+  start = chrono::steady_clock::now();
+  int size_of_string = (int) text.size() + 1;
+  int recursion_counter = 0;
+  vector<int> T_array(size_of_string);
+  vector<int> SA_array(size_of_string, -1);
+  assign_index_to_T(T_array, text, size_of_string);
+  run_SAIS(SA_array, T_array, size_of_string, recursion_counter);
+  vector<int> filtered;
+  for(int r = 0; r < size_of_string; r++){
+    int p = SA_array[r];
+    if(p < (int) text.size() && is_word_char(text[p]) && (p == 0 || !is_word_char(text[p - 1]))){
+      filtered.push_back(p);
+    }
+  }
+  double full_seconds = seconds_since(start);
+
+  cerr << "text: " << text.size() << " bytes, " << word_SA.size() << " words" << endl;
+  cerr << "word suffix array: " << word_seconds << " s, " << word_SA.size() * sizeof(int) <<
+    " bytes" << endl;
+  cerr << "full suffix array, filtered: " << full_seconds << " s, " <<
+    (long long) size_of_string * sizeof(int) << " bytes" << endl;
+  cerr << patterns.size() << " word-prefix searches: " << search_seconds << " s, " << total <<
+    " matches" << endl;
+  if(filtered != word_SA){
+    cerr << "ERROR: the word suffix array differs from the filtered suffix array." << endl;
+    return -1;
+  }
+  cerr << "arrays match" << endl;
+  return 0;
+}